@@ -0,0 +1,62 @@
+/**
+ * Example BasilC native extension. Build with `make plugins` and load with
+ * BasilC-import(./out/hello.so) or basilc -L ./out/hello.so
+ *
+ * BasilC-shout(text) prints text in upper case
+ * BasilC-increment(variable) adds one to a numeric variable
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include <plugin.h>
+
+static const basilc_host_api_t *host;
+
+static bool init(const basilc_host_api_t *api) {
+    host = api;
+    return true;
+}
+
+static bool shout_callback(stack_node_t **node) {
+    char *parsed = host->parse_var_string((*node)->parameters[0]);
+    char *text = parsed != NULL ? parsed : (*node)->parameters[0];
+    char *c;
+    for (c = text; *c; c++) putchar(toupper((unsigned char) *c));
+    putchar('\n');
+    host->free_var_string(parsed);
+    return true;
+}
+
+static bool increment_callback(stack_node_t **node) {
+    char *data = host->get_var((*node)->parameters[0]);
+    if (data == NULL) return false;
+
+    char buf[MAX_DATA_SIZE];
+    snprintf(buf, sizeof(buf), "%d", atoi(data) + 1);
+    host->set_var((*node)->parameters[0], buf);
+    return true;
+}
+
+static cmd_declaration_t commands[] = {
+    {
+        .name = "shout",
+        .num_args = -1,
+        .handle_cmd = shout_callback,
+    },
+    {
+        .name = "increment",
+        .num_args = 1,
+        .handle_cmd = increment_callback,
+    },
+};
+
+basilc_plugin_t basilc_plugin = {
+    .abi_version = BASILC_PLUGIN_ABI_VERSION,
+    .node_size = sizeof(stack_node_t),
+    .name = "hello",
+    .commands = commands,
+    .num_commands = sizeof(commands) / sizeof(commands[0]),
+    .init = init,
+};
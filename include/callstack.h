@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+
+// Max depth of nested call()s
+#define CALL_STACK_MAX 1024
+
+// A variable hidden by local(), restored by return()
+struct saved_var {
+    variable_stack_node_t *var;
+    bool existed; // Whether the variable was defined before local()
+    value_t value;
+    struct collection *coll;
+    struct saved_var *next;
+};
+typedef struct saved_var saved_var_t;
+
+struct call_frame {
+    stack_node_t *ret; // Node to continue at after return()
+    saved_var_t *locals; // Most recent first
+};
+typedef struct call_frame call_frame_t;
+
+bool call_push(stack_node_t *ret);
+stack_node_t * call_pop();
+bool call_local(char *name);
+void call_reset();
@@ -10,14 +10,22 @@ enum parse_error {
     ERR_PAREN,
     ERR_INVALID_CMD,
     ERR_ARGS,
-    ERR_SPECIAL_PARSE
+    ERR_SPECIAL_PARSE,
+    ERR_QUOTE,
+    ERR_ESCAPE,
+    ERR_TRAILING,
+    ERR_ARG_LENGTH
 };
 
 extern char parse_error_msgs[][32];
+extern __thread int32_t parse_error_col;
+
+// num_args for a command whose last one of `n` arguments may be left out
+#define CMD_OPTIONAL_LAST(n) (-(n))
 
 struct cmd_declaration {
     char *name;
-    int8_t num_args;
+    int8_t num_args; // -1 puts the whole body into one argument
     bool (*handle_cmd)(stack_node_t **);
     bool (*special_parse)(void);
 };
@@ -38,6 +46,9 @@ extern registered_cmd_stack_t *current_cmd_stack;
 void init_cmd_stack();
 void register_cmd(cmd_declaration_t *dec);
 registered_cmd_stack_t * cmd_stack_search_label(char *label);
+int32_t parse_command_node(char *input, int32_t input_len, stack_node_t *node,
+                           registered_cmd_stack_t **res_out);
+int32_t parse_finish_command(registered_cmd_stack_t *res);
 int32_t parse_user_command(char *input, int32_t input_len);
 bool execute_command(stack_node_t **node);
 void __debug_print_cmd_stack();
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+#include <value.h>
+
+enum collection_kind {
+    COLL_MAP,
+    COLL_ARRAY,
+    COLL_ANY // Only used for lookups
+};
+
+// An element of a collection. Map entries are kept in insertion order, and
+// deleted ones are left as holes (key == NULL) until the table is resized.
+struct coll_entry {
+    char *key; // NULL for array elements and deleted map entries
+    uint32_t hash;
+    value_t value;
+};
+typedef struct coll_entry coll_entry_t;
+
+struct collection {
+    uint8_t kind;
+    coll_entry_t *entries;
+    int32_t num_entries; // Including holes
+    int32_t max_entries;
+    int32_t len; // Live entries
+    int32_t *slots; // Open addressing index into entries, maps only
+    int32_t num_slots; // Power of two
+};
+typedef struct collection collection_t;
+
+// Iteration state of an each() node, kept in its data field
+struct each_state {
+    int32_t cursor; // Next entry to visit
+    bool resume; // Set by endeach() to continue instead of restarting
+};
+typedef struct each_state each_state_t;
+
+collection_t * collection_create(uint8_t kind);
+void collection_free(collection_t *coll);
+value_t * collection_get(collection_t *coll, char *key);
+value_t * collection_put(collection_t *coll, char *key);
+bool collection_del(collection_t *coll, char *key);
+value_t * collection_push(collection_t *coll);
+value_t * collection_at(collection_t *coll, int32_t index);
+void collection_truncate(collection_t *coll, int32_t len);
+collection_t * collection_of_var(char *name, uint8_t kind, bool create);
+collection_t * collection_array_of_var(char *name);
+each_state_t * collection_each_state(stack_node_t *node);
+bool collection_each(stack_node_t *node, bool first);
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <main.h>
+
+void emit_c_program(FILE *out, stack_node_t *start, char *source_name);
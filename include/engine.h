@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+
+// Use computed goto dispatch where the compiler supports it
+#if defined(__GNUC__) && !defined(ENGINE_NO_THREADING)
+#define ENGINE_THREADED
+#endif
+
+enum opcode {
+    OP_HALT,
+    OP_CALL, // Generic call of a registered handler
+    OP_SAY, // say() of a literal
+    OP_SAYLN, // sayln() of a literal
+    OP_SAY_SAYLN, // Superinstruction: literal say() followed by sayln()
+    OP_DEFINE,
+    OP_DEFINE_GOTO, // Superinstruction: define() followed by goto()
+    OP_GOTO,
+    OP_IF,
+    OP_NUM_OPCODES
+};
+
+// A compiled instruction
+struct insn {
+    uint8_t op;
+    int32_t target; // Jump destination for goto(), if() and loops
+    bool (*handle_cmd)(stack_node_t **);
+    stack_node_t *node; // Node this instruction was compiled from
+    uint32_t hotness; // Times a backward goto() was taken, see jit.c
+    int32_t (*native)(void); // Compiled loop entered by a backward goto()
+};
+typedef struct insn insn_t;
+
+struct program {
+    insn_t *code;
+    int32_t len;
+};
+typedef struct program program_t;
+
+program_t * engine_compile(stack_node_t *start);
+void engine_execute(program_t *prog);
+void engine_execute_lines(program_t *prog, bool print);
+bool engine_eval_if(stack_node_t *node);
+int32_t engine_call(insn_t *insn);
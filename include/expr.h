@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <main.h>
+
+// Max number of instructions in a compiled expression, which is enough for
+// any parameter
+#define EXPR_MAX_INSNS STACK_PARAMETER_MAX_LENGTH
+
+// Max depth of the evaluation stack
+#define EXPR_STACK_MAX 32
+
+enum expr_op {
+    EXPR_NUM, // Push a number
+    EXPR_STR, // Push a string literal
+    EXPR_VAR, // Push the value of a variable
+    EXPR_NEG,
+    EXPR_NOT,
+    EXPR_BOOL, // Replace the top with 1 or 0
+    EXPR_AND, // Jump to target leaving 0 if the top is false, or pop it
+    EXPR_OR, // Jump to target leaving 1 if the top is true, or pop it
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_MOD,
+    EXPR_EQ,
+    EXPR_NE,
+    EXPR_LT,
+    EXPR_GT,
+    EXPR_LE,
+    EXPR_GE
+};
+
+// An instruction of a compiled expression, in reverse polish order
+struct expr_insn {
+    uint8_t op;
+    int32_t target; // Instruction to jump to for EXPR_AND and EXPR_OR
+    int64_t num; // For EXPR_NUM
+    char *str; // Literal of EXPR_STR, or name of EXPR_VAR
+};
+typedef struct expr_insn expr_insn_t;
+
+// A compiled expression, with its strings stored after the instructions
+struct expr {
+    int32_t len;
+    expr_insn_t code[];
+};
+typedef struct expr expr_t;
+
+// A value on the evaluation stack
+struct expr_value {
+    bool is_num;
+    int64_t num;
+    char *str; // If !is_num. Points into a variable or the expression.
+};
+typedef struct expr_value expr_value_t;
+
+expr_t * expr_compile(char *text, char **error);
+void expr_eval(expr_t *expr, expr_value_t *result);
+bool expr_truthy(expr_value_t *value);
+bool expr_is_constant(expr_t *expr);
+void expr_format(expr_value_t *value, char *buf, size_t len);
+expr_t * expr_of_node(stack_node_t *node, int32_t param);
+bool expr_parse_node(int32_t param);
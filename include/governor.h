@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Exit status of a run that exceeded one of its limits
+#define GOVERNOR_EXIT_CODE 3
+
+enum governor_limit {
+    LIMIT_INSNS,
+    LIMIT_TIME,
+    LIMIT_MEM
+};
+
+// Limits of a run, 0 means unlimited
+struct basilc_limits {
+    uint64_t max_insns; // Executed commands
+    uint32_t timeout_ms; // Wall-clock time from governor_set_limits()
+    size_t max_mem; // Bytes allocated through basilc_malloc()
+
+    // Called when a limit is exceeded instead of exiting with
+    // GOVERNOR_EXIT_CODE. It must not return, e.g. by calling longjmp().
+    void (*on_exceeded)(int32_t limit);
+};
+typedef struct basilc_limits basilc_limits_t;
+
+extern bool governor_active;
+extern uint64_t governor_insns;
+
+void governor_set_limits(basilc_limits_t *limits);
+void governor_check();
+void governor_jit_edge(uint64_t insns);
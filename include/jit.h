@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <engine.h>
+
+// The JIT only generates code for x86-64 on POSIX systems
+#if defined(__x86_64__) && defined(__unix__)
+#define JIT_SUPPORTED
+#endif
+
+// Backward goto()s taken before the loop they close is compiled
+#define JIT_HOT_THRESHOLD 100
+
+extern bool jit_enabled;
+
+void jit_init();
+int32_t jit_backward_edge(program_t *prog, insn_t *ip);
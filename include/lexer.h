@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+
+// Region of the lexed line, as an offset and length into the input
+struct lex_span {
+    int32_t start;
+    int32_t len;
+};
+typedef struct lex_span lex_span_t;
+
+// Result of lexing a single command line
+struct lexed_cmd {
+    lex_span_t name; // Command name, without the BasilC- prefix
+    lex_span_t body; // Everything between the outer parenthesis
+    int32_t num_args; // Number of top-level, comma separated arguments
+    lex_span_t args[STACK_PARAMETER_MAX_AMOUNT];
+};
+typedef struct lexed_cmd lexed_cmd_t;
+
+int32_t lex_command(char *input, int32_t input_len, lexed_cmd_t *out);
+int32_t lex_decode_arg(char *buf, int32_t buf_len, char *input,
+                       lex_span_t span, bool trim);
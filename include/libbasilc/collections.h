@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <main.h>
+#include <cmd.h>
+
+// Definition for BasilC-put()
+bool basilc_put_callback(stack_node_t **node);
+cmd_declaration_t basilc_put = {
+    .name = "put",
+    .num_args = 3,
+    .handle_cmd = basilc_put_callback,
+};
+
+// Definition for BasilC-get()
+bool basilc_get_callback(stack_node_t **node);
+cmd_declaration_t basilc_get = {
+    .name = "get",
+    .num_args = 3,
+    .handle_cmd = basilc_get_callback,
+};
+
+// Definition for BasilC-del()
+bool basilc_del_callback(stack_node_t **node);
+cmd_declaration_t basilc_del = {
+    .name = "del",
+    .num_args = 2,
+    .handle_cmd = basilc_del_callback,
+};
+
+// Definition for BasilC-len()
+bool basilc_len_callback(stack_node_t **node);
+cmd_declaration_t basilc_len = {
+    .name = "len",
+    .num_args = 2,
+    .handle_cmd = basilc_len_callback,
+};
+
+// Definition for BasilC-push()
+bool basilc_push_callback(stack_node_t **node);
+cmd_declaration_t basilc_push = {
+    .name = "push",
+    .num_args = 2,
+    .handle_cmd = basilc_push_callback,
+};
+
+// Definition for BasilC-each()
+bool basilc_each_callback(stack_node_t **node);
+bool basilc_each_special_parse();
+cmd_declaration_t basilc_each = {
+    .name = "each",
+    .num_args = 2,
+    .handle_cmd = basilc_each_callback,
+    .special_parse = basilc_each_special_parse,
+};
+
+// Definition for BasilC-endeach()
+bool basilc_endeach_callback(stack_node_t **node);
+bool basilc_endeach_special_parse();
+cmd_declaration_t basilc_endeach = {
+    .name = "endeach",
+    .num_args = 0,
+    .handle_cmd = basilc_endeach_callback,
+    .special_parse = basilc_endeach_special_parse,
+};
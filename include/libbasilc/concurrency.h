@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <main.h>
+#include <cmd.h>
+
+// Definition for BasilC-parallel()
+bool basilc_parallel_callback(stack_node_t **node);
+bool basilc_parallel_special_parse();
+cmd_declaration_t basilc_parallel = {
+    .name = "parallel",
+    .num_args = 0,
+    .handle_cmd = basilc_parallel_callback,
+    .special_parse = basilc_parallel_special_parse,
+};
+
+// Definition for BasilC-endparallel()
+bool basilc_endparallel_special_parse();
+cmd_declaration_t basilc_endparallel = {
+    .name = "endparallel",
+    .num_args = 0,
+    .special_parse = basilc_endparallel_special_parse,
+};
+
+// Definition for BasilC-pareach()
+bool basilc_pareach_callback(stack_node_t **node);
+bool basilc_pareach_special_parse();
+cmd_declaration_t basilc_pareach = {
+    .name = "pareach",
+    .num_args = 2,
+    .handle_cmd = basilc_pareach_callback,
+    .special_parse = basilc_pareach_special_parse,
+};
+
+// Definition for BasilC-endpareach()
+bool basilc_endpareach_special_parse();
+cmd_declaration_t basilc_endpareach = {
+    .name = "endpareach",
+    .num_args = 0,
+    .special_parse = basilc_endpareach_special_parse,
+};
@@ -23,6 +23,46 @@ cmd_declaration_t basilc_endif = {
     .special_parse = basilc_endif_special_parse,
 };
 
+// Definition for BasilC-while()
+bool basilc_while_callback(stack_node_t **node);
+bool basilc_while_special_parse();
+cmd_declaration_t basilc_while = {
+    .name = "while",
+    .num_args = 1,
+    .handle_cmd = basilc_while_callback,
+    .special_parse = basilc_while_special_parse,
+};
+
+// Definition for BasilC-endwhile()
+bool basilc_endwhile_callback(stack_node_t **node);
+bool basilc_endwhile_special_parse();
+cmd_declaration_t basilc_endwhile = {
+    .name = "endwhile",
+    .num_args = 0,
+    .handle_cmd = basilc_endwhile_callback,
+    .special_parse = basilc_endwhile_special_parse,
+};
+
+// Definition for BasilC-break()
+bool basilc_break_callback(stack_node_t **node);
+bool basilc_break_special_parse();
+cmd_declaration_t basilc_break = {
+    .name = "break",
+    .num_args = 0,
+    .handle_cmd = basilc_break_callback,
+    .special_parse = basilc_break_special_parse,
+};
+
+// Definition for BasilC-continue()
+bool basilc_continue_callback(stack_node_t **node);
+bool basilc_continue_special_parse();
+cmd_declaration_t basilc_continue = {
+    .name = "continue",
+    .num_args = 0,
+    .handle_cmd = basilc_continue_callback,
+    .special_parse = basilc_continue_special_parse,
+};
+
 // Definition of BasilC-label()
 bool basilc_label_callback(stack_node_t **node);
 cmd_declaration_t basilc_label = {
@@ -38,6 +78,32 @@ cmd_declaration_t basilc_goto = {
     .handle_cmd = basilc_goto_callback,
 };
 
+// Definition for BasilC-call()
+bool basilc_call_callback(stack_node_t **node);
+bool basilc_call_special_parse();
+cmd_declaration_t basilc_call = {
+    .name = "call",
+    .num_args = 1,
+    .handle_cmd = basilc_call_callback,
+    .special_parse = basilc_call_special_parse,
+};
+
+// Definition for BasilC-return()
+bool basilc_return_callback(stack_node_t **node);
+cmd_declaration_t basilc_return = {
+    .name = "return",
+    .num_args = 0,
+    .handle_cmd = basilc_return_callback,
+};
+
+// Definition for BasilC-local()
+bool basilc_local_callback(stack_node_t **node);
+cmd_declaration_t basilc_local = {
+    .name = "local",
+    .num_args = 1,
+    .handle_cmd = basilc_local_callback,
+};
+
 // Definition for BasilC-end()
 bool basilc_end_callback(stack_node_t **node);
 cmd_declaration_t basilc_end = {
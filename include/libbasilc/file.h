@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <main.h>
+#include <cmd.h>
+
+// Definition for BasilC-open()
+bool basilc_open_callback(stack_node_t **node);
+cmd_declaration_t basilc_open = {
+    .name = "open",
+    .num_args = 3,
+    .handle_cmd = basilc_open_callback,
+};
+
+// Definition for BasilC-readline()
+bool basilc_readline_callback(stack_node_t **node);
+cmd_declaration_t basilc_readline = {
+    .name = "readline",
+    .num_args = 2,
+    .handle_cmd = basilc_readline_callback,
+};
+
+// Definition for BasilC-csv()
+bool basilc_csv_callback(stack_node_t **node);
+cmd_declaration_t basilc_csv = {
+    .name = "csv",
+    .num_args = 2,
+    .handle_cmd = basilc_csv_callback,
+};
+
+// Definition for BasilC-eof()
+bool basilc_eof_callback(stack_node_t **node);
+cmd_declaration_t basilc_eof = {
+    .name = "eof",
+    .num_args = 2,
+    .handle_cmd = basilc_eof_callback,
+};
+
+// Definition for BasilC-write()
+bool basilc_write_callback(stack_node_t **node);
+cmd_declaration_t basilc_write = {
+    .name = "write",
+    .num_args = 2,
+    .handle_cmd = basilc_write_callback,
+};
+
+// Definition for BasilC-writeln()
+bool basilc_writeln_callback(stack_node_t **node);
+cmd_declaration_t basilc_writeln = {
+    .name = "writeln",
+    .num_args = 2,
+    .handle_cmd = basilc_writeln_callback,
+};
+
+// Definition for BasilC-close()
+bool basilc_close_callback(stack_node_t **node);
+cmd_declaration_t basilc_close = {
+    .name = "close",
+    .num_args = 1,
+    .handle_cmd = basilc_close_callback,
+};
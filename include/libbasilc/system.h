@@ -13,6 +13,22 @@ cmd_declaration_t basilc_yolo = {
     .handle_cmd = basilc_yolo_callback,
 };
 
+// Definition for BasilC-capture()
+bool basilc_capture_callback(stack_node_t **node);
+cmd_declaration_t basilc_capture = {
+    .name = "capture",
+    .num_args = CMD_OPTIONAL_LAST(3),
+    .handle_cmd = basilc_capture_callback,
+};
+
+// Definition for BasilC-capturelines()
+bool basilc_capturelines_callback(stack_node_t **node);
+cmd_declaration_t basilc_capturelines = {
+    .name = "capturelines",
+    .num_args = CMD_OPTIONAL_LAST(3),
+    .handle_cmd = basilc_capturelines_callback,
+};
+
 // Definition for BasilC-naptime()
 bool basilc_naptime_callback(stack_node_t **node);
 cmd_declaration_t basilc_naptime = {
@@ -20,3 +36,19 @@ cmd_declaration_t basilc_naptime = {
     .num_args = 1,
     .handle_cmd = basilc_naptime_callback,
 };
+
+// Definition for BasilC-import()
+bool basilc_import_special_parse();
+cmd_declaration_t basilc_import = {
+    .name = "import",
+    .num_args = 1,
+    .special_parse = basilc_import_special_parse,
+};
+
+// Definition for BasilC-include()
+bool basilc_include_special_parse();
+cmd_declaration_t basilc_include = {
+    .name = "include",
+    .num_args = 1,
+    .special_parse = basilc_include_special_parse,
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <main.h>
+#include <cmd.h>
+
+// Definition for BasilC-match()
+bool basilc_match_callback(stack_node_t **node);
+bool basilc_match_special_parse();
+cmd_declaration_t basilc_match = {
+    .name = "match",
+    .num_args = 3,
+    .handle_cmd = basilc_match_callback,
+    .special_parse = basilc_match_special_parse,
+};
+
+// Definition for BasilC-upper()
+bool basilc_upper_callback(stack_node_t **node);
+cmd_declaration_t basilc_upper = {
+    .name = "upper",
+    .num_args = 2,
+    .handle_cmd = basilc_upper_callback,
+};
+
+// Definition for BasilC-lower()
+bool basilc_lower_callback(stack_node_t **node);
+cmd_declaration_t basilc_lower = {
+    .name = "lower",
+    .num_args = 2,
+    .handle_cmd = basilc_lower_callback,
+};
+
+// Definition for BasilC-trim()
+bool basilc_trim_callback(stack_node_t **node);
+cmd_declaration_t basilc_trim = {
+    .name = "trim",
+    .num_args = 2,
+    .handle_cmd = basilc_trim_callback,
+};
+
+// Definition for BasilC-find()
+bool basilc_find_callback(stack_node_t **node);
+cmd_declaration_t basilc_find = {
+    .name = "find",
+    .num_args = 3,
+    .handle_cmd = basilc_find_callback,
+};
+
+// Definition for BasilC-replace()
+bool basilc_replace_callback(stack_node_t **node);
+cmd_declaration_t basilc_replace = {
+    .name = "replace",
+    .num_args = 4,
+    .handle_cmd = basilc_replace_callback,
+};
+
+// Definition for BasilC-substr()
+bool basilc_substr_callback(stack_node_t **node);
+cmd_declaration_t basilc_substr = {
+    .name = "substr",
+    .num_args = 4,
+    .handle_cmd = basilc_substr_callback,
+};
+
+// Definition for BasilC-split()
+bool basilc_split_callback(stack_node_t **node);
+cmd_declaration_t basilc_split = {
+    .name = "split",
+    .num_args = 3,
+    .handle_cmd = basilc_split_callback,
+};
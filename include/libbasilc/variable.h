@@ -12,3 +12,45 @@ cmd_declaration_t basilc_define = {
     .num_args = 2,
     .handle_cmd = basilc_define_callback,
 };
+
+// Definition for BasilC-let()
+bool basilc_let_callback(stack_node_t **node);
+bool basilc_let_special_parse();
+cmd_declaration_t basilc_let = {
+    .name = "let",
+    .num_args = 2,
+    .handle_cmd = basilc_let_callback,
+    .special_parse = basilc_let_special_parse,
+};
+
+// Definition for BasilC-append()
+bool basilc_append_callback(stack_node_t **node);
+cmd_declaration_t basilc_append = {
+    .name = "append",
+    .num_args = 2,
+    .handle_cmd = basilc_append_callback,
+};
+
+// Definition for BasilC-prepend()
+bool basilc_prepend_callback(stack_node_t **node);
+cmd_declaration_t basilc_prepend = {
+    .name = "prepend",
+    .num_args = 2,
+    .handle_cmd = basilc_prepend_callback,
+};
+
+// Definition for BasilC-persist()
+bool basilc_persist_callback(stack_node_t **node);
+cmd_declaration_t basilc_persist = {
+    .name = "persist",
+    .num_args = 1,
+    .handle_cmd = basilc_persist_callback,
+};
+
+// Definition for BasilC-checkpoint()
+bool basilc_checkpoint_callback(stack_node_t **node);
+cmd_declaration_t basilc_checkpoint = {
+    .name = "checkpoint",
+    .num_args = 0,
+    .handle_cmd = basilc_checkpoint_callback,
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size of the blocks read from the file at once
+#define READER_BLOCK_SIZE 65536
+
+// Splits a file into lines, reading it in large blocks
+struct line_reader {
+    FILE *fp;
+    char *buf;
+    size_t start; // First byte that wasn't returned yet
+    size_t end; // End of the data read so far
+    size_t cap; // Usable size of buf, which has room for one more byte
+    bool eof; // Whether fp has no more data
+};
+typedef struct line_reader line_reader_t;
+
+line_reader_t * reader_create(FILE *fp);
+char * reader_next_line(line_reader_t *reader, size_t *len);
+bool reader_at_end(line_reader_t *reader);
+void reader_free(line_reader_t *reader);
@@ -2,23 +2,37 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+
+#include <value.h>
 
 #define STACK_PARAMETER_MAX_AMOUNT 5 // Max parameters a command can have
 #define STACK_PARAMETER_MAX_LENGTH 100 // Max length of a parameter
 
 #define MAX_DATA_SIZE 32
 
+#define MAX_BLOCK_DEPTH 64 // Max nesting of each(), while() and similar blocks
+
 // General stack node contains command and pointer to parameter linked list
 struct stack_node {
     char *command;
     bool execute;
     char parameters[STACK_PARAMETER_MAX_AMOUNT][STACK_PARAMETER_MAX_LENGTH];
+    int32_t linenum; // Line of the script the node was parsed from
+    char *file; // Real path of the include()d file it is from, or NULL
+    int32_t seq; // Position in the general stack, see parse_cleanup()
+    int32_t pc; // Index of the compiled instruction, see engine.c
+    struct stack_node *block; // Other end of a block such as each()/endeach(),
+                              // or the label() of a call()
+    void *data; // Runtime state owned by the node's command
     struct stack_node *next;
 };
 
 struct variable_stack_node {
     char name[MAX_DATA_SIZE];
-    char data[MAX_DATA_SIZE];
+    value_t value;
+    struct collection *coll; // Set for maps and arrays, see collection.c
+    uint32_t generation; // Variables from before reset_vars() are missing
     struct variable_stack_node *next;
 };
 
@@ -35,15 +49,27 @@ extern bool monochrome_mode;
 extern bool hide_debugging;
 
 void stack_node_initialize(struct stack_node *s);
+void var_node_initialize(variable_stack_node_t *v);
 void parse_line(char *line, int line_len, int linenum);
+void parse_fail(char *line, int32_t line_len, int32_t linenum, int32_t result);
 void stack_execute();
 void parse_cleanup();
+bool block_open(stack_node_t *node);
+stack_node_t * block_close(stack_node_t *node, char *opener);
+bool block_inside(char *opener);
+int32_t block_depth(char *opener);
+stack_node_t * block_at(int32_t depth);
 stack_node_t * stack_search_label(char *label);
 variable_stack_node_t * var_stack_search_label(char *label);
+variable_stack_node_t * define_var(char *name, char *data);
+void redefine_var(variable_stack_node_t *var, char *data);
+void undefine_var(variable_stack_node_t *var);
+void reset_vars();
 void set_block_execute(stack_node_t *start, bool val);
 bool eval_conditional(char *cond);
+bool eval_node_conditional(stack_node_t *node);
 void exit_with_error(char *error);
 char * get_data_for_var(char *var_name);
-void prepare_var_string(char *str, int32_t num_vars);
 char * parse_var_string(char *str);
+bool print_var_string(char *str, FILE *out);
 void printANSIescape(char *code);
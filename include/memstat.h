@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Interpreter subsystems that memory is accounted to
+enum mem_category {
+    MEM_NODES, // stack_node_t
+    MEM_CODE, // Compiled instructions
+    MEM_CMDS, // registered_cmd_stack_t
+    MEM_VARS, // variable_stack_node_t
+    MEM_INTERP, // Buffers from parse_var_string()
+    MEM_SOURCE, // Script source buffer
+    MEM_FILES, // Buffers of open files
+    MEM_NUM_CATEGORIES
+};
+
+extern bool memstat_enabled;
+extern size_t memstat_limit;
+
+// Allocation wrappers, which only do accounting when -M is given
+#define basilc_malloc(size, category) \
+    (memstat_enabled ? memstat_malloc(size, category) : malloc(size))
+#define basilc_realloc(ptr, size, category) \
+    (memstat_enabled ? memstat_realloc(ptr, size, category) : realloc(ptr, size))
+#define basilc_free(ptr) \
+    (memstat_enabled ? memstat_free(ptr) : free(ptr))
+
+void memstat_init();
+void memstat_set_limit(size_t limit, void (*hook)(size_t total));
+void * memstat_malloc(size_t size, int32_t category);
+void * memstat_realloc(void *ptr, size_t size, int32_t category);
+void memstat_free(void *ptr);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+
+// Max depth of include()s within include()d files
+#define MODULE_MAX_DEPTH 16
+
+// Separates the namespace of an included file from its label names
+#define MODULE_SEPARATOR '.'
+
+void module_set_main(char *path);
+bool module_include(char *path);
+void module_parse_pending();
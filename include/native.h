@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+
+void native_init(int32_t argc, char **argv);
+bool native_bind(variable_stack_node_t **slot, char *name);
+void native_define(variable_stack_node_t **slot, stack_node_t *node);
+void native_exec(stack_node_t *node);
+void native_import(stack_node_t *node);
+int32_t native_exit();
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <main.h>
+
+// Highest supported -O level
+#define OPTIMIZE_MAX_LEVEL 2
+
+// Number of changes made by each optimizer pass
+struct optimize_report {
+    int32_t folded_ifs;
+    int32_t dead_nodes;
+    int32_t merged_says;
+    int32_t dead_defines;
+};
+typedef struct optimize_report optimize_report_t;
+
+void optimize_program(int32_t level, optimize_report_t *report);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <main.h>
+
+// Max number of worker threads
+#define PARALLEL_MAX_WORKERS 64
+
+// Number of locks shared variables are striped over
+#define PARALLEL_LOCK_STRIPES 64
+
+// A unit of work run by the pool: the nodes from start up to, but not
+// including, end
+struct task {
+    stack_node_t *start;
+    stack_node_t *end;
+    char *var_name; // Loop variable of pareach(), or NULL
+    char *var_value;
+    variable_stack_node_t *vars; // Variables defined by the task
+    struct task *parent; // Task that ran this one inline, or NULL
+    FILE *out; // Output of the task, written out once all tasks are done
+    char *out_buf;
+    size_t out_len;
+};
+typedef struct task task_t;
+
+extern bool parallel_active;
+
+void parallel_run(task_t *tasks, int32_t num_tasks);
+FILE * task_output();
+variable_stack_node_t * task_find_var(char *name);
+variable_stack_node_t * task_new_var(char *name);
+bool task_running();
+void task_lock_var(char *name);
+void task_unlock_var(char *name);
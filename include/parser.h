@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <main.h>
+#include <cmd.h>
+
+// Scripts are only split into chunks of at least this many bytes, since
+// smaller ones parse faster than threads start
+#define PARSE_MIN_CHUNK (1024 * 1024)
+
+// Max number of threads lexing a script
+#define PARSE_MAX_THREADS 64
+
+// A line lexed by a parser thread
+struct parsed_line {
+    registered_cmd_stack_t *cmd; // NULL if the line is parsed again in order
+    char *text; // Line in the source buffer, without its newline
+    int32_t len;
+};
+typedef struct parsed_line parsed_line_t;
+
+// The nodes lexed from one chunk of the script. They are linked to each
+// other, ending in an empty node, but not yet to the general stack.
+struct parse_segment {
+    char *start; // Chunk of the source buffer, ending after a newline
+    char *end;
+    int32_t num_lines; // Lines in the chunk, including those without a command
+    stack_node_t *head;
+    stack_node_t *tail; // Empty node at the end
+    parsed_line_t *lines; // One for every node
+    int32_t num_nodes;
+    int32_t max_nodes;
+};
+typedef struct parse_segment parse_segment_t;
+
+void parse_source(char *source, size_t size);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <regex.h>
+
+// Max number of groups returned by a match, including the whole match
+#define PATTERN_MAX_GROUPS 32
+
+// Max number of patterns kept compiled by pattern_get()
+#define PATTERN_CACHE_SIZE 256
+
+// A compiled POSIX extended regular expression
+struct pattern {
+    char *source;
+    uint32_t hash;
+    regex_t re;
+    int32_t num_groups; // Including the whole match
+    char *prefix; // Literal text every match starts with
+    size_t prefix_len;
+    bool anchored; // Whether the pattern starts with ^
+};
+typedef struct pattern pattern_t;
+
+// Start and end offsets of a group, -1 if it didn't take part in the match
+struct pattern_group {
+    int32_t start;
+    int32_t end;
+};
+typedef struct pattern_group pattern_group_t;
+
+pattern_t * pattern_compile(char *source);
+pattern_t * pattern_get(char *source, bool *temporary);
+void pattern_free(pattern_t *pat);
+int32_t pattern_match(pattern_t *pat, char *text, pattern_group_t *groups);
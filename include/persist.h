@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <main.h>
+
+#define PERSIST_MAGIC "BASILCST"
+#define PERSIST_VERSION 1
+
+// Number of variables a state file has room for, a power of two
+#define PERSIST_SLOTS 1024
+
+// Longest value that can be persisted
+#define PERSIST_VALUE_MAX 1024
+
+// Suffix of the default state file, added to the script path
+#define PERSIST_DEFAULT_SUFFIX ".state"
+
+// One copy of a persisted value. A copy is valid if its checksum matches.
+struct persist_copy {
+    uint64_t seq; // The valid copy with the higher seq is current
+    uint32_t len;
+    uint32_t checksum; // Of seq, len and data
+    char data[PERSIST_VALUE_MAX];
+};
+typedef struct persist_copy persist_copy_t;
+
+// A variable in the state file. Values are written to the older copy, so
+// the current one survives a crash in the middle of a write.
+struct persist_slot {
+    char name[MAX_DATA_SIZE]; // Empty for free slots
+    persist_copy_t copies[2];
+};
+typedef struct persist_slot persist_slot_t;
+
+struct persist_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_slots;
+    uint32_t value_max;
+    uint32_t reserved;
+};
+typedef struct persist_header persist_header_t;
+
+extern char *persist_path;
+
+bool persist_bind(char *name);
+bool persist_checkpoint();
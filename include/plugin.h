@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * Native extension ABI. A plugin is a shared object that exports a
+ * basilc_plugin_t named `basilc_plugin`:
+ *
+ *     static cmd_declaration_t commands[] = { ... };
+ *     basilc_plugin_t basilc_plugin = {
+ *         .abi_version = BASILC_PLUGIN_ABI_VERSION,
+ *         .node_size = sizeof(stack_node_t),
+ *         .name = "example",
+ *         .commands = commands,
+ *         .num_commands = sizeof(commands) / sizeof(commands[0]),
+ *     };
+ *
+ * and is loaded with BasilC-import(path) or basilc -L path.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <main.h>
+#include <cmd.h>
+
+// Bump whenever cmd_declaration_t or basilc_host_api_t change
+#define BASILC_PLUGIN_ABI_VERSION 2
+
+// Interpreter services available to plugins
+struct basilc_host_api {
+    uint32_t abi_version;
+    // Value of a variable, or NULL if it isn't declared
+    char * (*get_var)(char *name);
+    // Set a variable, declaring it if needed
+    void (*set_var)(char *name, char *data);
+    // Substitute $variables in a string, see parse_var_string()
+    char * (*parse_var_string)(char *str);
+    // Release a string returned by parse_var_string()
+    void (*free_var_string)(char *str);
+    void (*exit_with_error)(char *error);
+};
+typedef struct basilc_host_api basilc_host_api_t;
+
+struct basilc_plugin {
+    uint32_t abi_version;
+    size_t node_size; // sizeof(stack_node_t) the plugin was built with
+    char *name;
+    cmd_declaration_t *commands;
+    int32_t num_commands;
+    // Called once after loading, may be NULL. Returning false fails the load.
+    bool (*init)(const basilc_host_api_t *host);
+};
+typedef struct basilc_plugin basilc_plugin_t;
+
+bool plugin_load(char *path);
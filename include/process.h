@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Defaults for --capture-max and --capture-timeout
+#define CAPTURE_DEFAULT_MAX (64 * 1024 * 1024)
+#define CAPTURE_DEFAULT_TIMEOUT_MS 60000
+
+// Size of the reads from the pipe
+#define CAPTURE_READ_SIZE 65536
+
+// Max number of words in a command
+#define CAPTURE_MAX_ARGS 64
+
+// Exit statuses reported for commands that didn't exit by themselves,
+// following the shell and timeout(1)
+#define CAPTURE_STATUS_NOT_FOUND 127
+#define CAPTURE_STATUS_TIMEOUT 124
+
+extern size_t capture_max;
+extern uint32_t capture_timeout_ms;
+
+// Receives output as it is read
+typedef void (*capture_sink_t)(char *data, size_t len, void *ctx);
+
+bool process_capture(char *cmd, capture_sink_t sink, void *ctx,
+                     int32_t *status);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <main.h>
+
+// Sampling needs setitimer() and SIGPROF
+#ifdef __unix__
+#define SAMPLE_SUPPORTED
+#endif
+
+#define SAMPLE_DEFAULT_HZ 1000
+#define SAMPLE_DEFAULT_OUTPUT "basilc.folded"
+
+// Node being executed, published by the execution loops for the profiler
+extern stack_node_t * volatile sample_node;
+
+bool sample_start(int32_t hz, char *output, char *script_name);
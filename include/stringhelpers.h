@@ -1,12 +1,14 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 void shift_string_left(char *str, int32_t start, int32_t n);
 int32_t get_char_occurances(char *str, char *c);
-int32_t split_string_delimiter(char *buf, char *str, char *delim);
-int32_t split_string_delimiter_rev(char *buf, char *str, char *delim);
 int32_t str_index_of(char *str, char *c);
 int32_t str_index_of_n(char *str, char *c, int32_t n);
 int32_t str_index_of_skip(char *str, char *c, int32_t skip);
 int32_t find_option(int argc, char **argv, char *request, int32_t *counter);
+char * find_long_option(int argc, char **argv, char *name);
+uint32_t str_hash(char *str, size_t len);
+uint64_t parse_size(char *str);
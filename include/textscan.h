@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void text_upper(char *dst, char *src, size_t len);
+void text_lower(char *dst, char *src, size_t len);
+size_t text_blank_prefix(char *str, size_t len);
+size_t text_blank_suffix(char *str, size_t len);
+char * text_find(char *haystack, size_t len, char *needle, size_t needle_len);
+size_t text_index(char *str, size_t len, char a, char b, uint32_t *pos);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Phases of a run reported by -t
+enum timing_phase {
+    PHASE_LOAD, // Reading the script
+    PHASE_PARSE, // Parsing, parse checks and the optimizer
+    PHASE_EXECUTE,
+    PHASE_NUM_PHASES
+};
+
+// Latency histograms have 16 sub-buckets per power of two, so percentiles
+// are accurate to within 1/16 of their value
+#define TIMING_SUB_BUCKETS 16
+#define TIMING_NUM_BUCKETS (61 * TIMING_SUB_BUCKETS)
+
+extern bool timing_enabled;
+
+void timing_init(bool json);
+void timing_phase(int32_t phase);
+uint64_t timing_now();
+void timing_record(char *command, uint64_t ns);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Values longer than this are kept as a rope of chunks rather than one buffer
+#define VALUE_CHUNK_MAX 65536
+
+// A piece of a value. Text sits at buf+start and is always NUL terminated,
+// with free space kept on both sides so that appends and prepends are
+// amortized O(1).
+struct value_chunk {
+    char *buf;
+    size_t start;
+    size_t len;
+    size_t cap;
+    struct value_chunk *next;
+};
+typedef struct value_chunk value_chunk_t;
+
+// The contents of a variable
+struct value {
+    value_chunk_t *head;
+    value_chunk_t *tail;
+    size_t len;
+};
+typedef struct value value_t;
+
+void value_init(value_t *v);
+void value_set(value_t *v, char *str, size_t len);
+void value_append(value_t *v, char *str, size_t len);
+void value_prepend(value_t *v, char *str, size_t len);
+char * value_flatten(value_t *v);
+size_t value_copy(value_t *v, char *dst);
+void value_write(value_t *v, FILE *out);
+void value_free(value_t *v);
@@ -0,0 +1,108 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the return stack behind call() and return(). Frames
+ * live in a fixed array, so a call or return is a push or pop and a single
+ * jump, whichever engine runs the script.
+ *
+ * local() gives a variable a fresh empty value for the rest of the call.
+ * The old value is moved into the frame and moved back by return(), and a
+ * variable that didn't exist before is removed again.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <callstack.h>
+#include <collection.h>
+#include <memstat.h>
+
+static call_frame_t frames[CALL_STACK_MAX];
+static int32_t num_frames;
+
+/**
+ * Enter a subroutine that will return to `ret`
+ * @return false if calls are nested too deeply
+ */
+bool call_push(stack_node_t *ret) {
+    if (num_frames == CALL_STACK_MAX) return false;
+    frames[num_frames].ret = ret;
+    frames[num_frames].locals = NULL;
+    num_frames++;
+    return true;
+}
+
+static void discard_locals(call_frame_t *frame, bool restore) {
+    saved_var_t *saved = frame->locals;
+    while (saved != NULL) {
+        saved_var_t *next = saved->next;
+        if (!restore) {
+            value_free(&saved->value);
+            if (saved->coll != NULL) collection_free(saved->coll);
+        } else if (saved->existed) {
+            variable_stack_node_t *var = saved->var;
+            value_free(&var->value);
+            if (var->coll != NULL) collection_free(var->coll);
+            var->value = saved->value;
+            var->coll = saved->coll;
+        } else {
+            undefine_var(saved->var);
+        }
+        basilc_free(saved);
+        saved = next;
+    }
+    frame->locals = NULL;
+}
+
+/**
+ * Leave the innermost subroutine, restoring its local variables
+ * @return the node to continue at, or NULL if there is no call to return from
+ */
+stack_node_t * call_pop() {
+    if (num_frames == 0) return NULL;
+    call_frame_t *frame = &frames[--num_frames];
+    discard_locals(frame, true);
+    return frame->ret;
+}
+
+/**
+ * Make a variable local to the innermost subroutine
+ * @return false outside of a subroutine
+ */
+bool call_local(char *name) {
+    if (num_frames == 0) return false;
+
+    saved_var_t *saved = basilc_malloc(sizeof(saved_var_t), MEM_VARS);
+    variable_stack_node_t *var = var_stack_search_label(name);
+    saved->existed = var != NULL;
+    if (var != NULL) {
+        // Move the value out of the way
+        saved->value = var->value;
+        saved->coll = var->coll;
+        value_init(&var->value);
+        var->coll = NULL;
+    } else {
+        value_init(&saved->value);
+        saved->coll = NULL;
+    }
+    saved->var = define_var(name, "");
+
+    call_frame_t *frame = &frames[num_frames-1];
+    saved->next = frame->locals;
+    frame->locals = saved;
+    return true;
+}
+
+/**
+ * Drop all frames without returning, for when the program starts over
+ */
+void call_reset() {
+    while (num_frames > 0) discard_locals(&frames[--num_frames], false);
+}
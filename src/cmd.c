@@ -15,6 +15,9 @@
 #include <main.h>
 #include <cmd.h>
 #include <stringhelpers.h>
+#include <lexer.h>
+#include <memstat.h>
+#include <timing.h>
 
 registered_cmd_stack_t *root_cmd;
 registered_cmd_stack_t *current_cmd_stack;
@@ -24,14 +27,23 @@ char parse_error_msgs[][32] = {
     "Missing parenthesis",
     "Invalid command",
     "Incorrect arguments",
-    "Failed special parse"
+    "Failed special parse",
+    "Unterminated string",
+    "Dangling escape character",
+    "Unexpected text after command",
+    "Argument too long"
 };
 
+// Column (starting at 1) of the last parse error, or 0 if unknown. Lines are
+// lexed on several threads by parser.c, so every thread has its own.
+__thread int32_t parse_error_col;
+
 /**
  * Initalize the command stack
  */
 void init_cmd_stack() {
-    root_cmd = (registered_cmd_stack_t *) malloc(sizeof(registered_cmd_stack_t));
+    root_cmd = (registered_cmd_stack_t *)
+               basilc_malloc(sizeof(registered_cmd_stack_t), MEM_CMDS);
     current_cmd_stack = root_cmd;
 }
 
@@ -47,7 +59,8 @@ void register_cmd(cmd_declaration_t *dec) {
 
     // Extend stack
     current_cmd_stack->next = (registered_cmd_stack_t *)
-                              malloc(sizeof(registered_cmd_stack_t));
+                              basilc_malloc(sizeof(registered_cmd_stack_t),
+                                            MEM_CMDS);
     current_cmd_stack = current_cmd_stack->next;
 }
 
@@ -71,106 +84,109 @@ registered_cmd_stack_t * cmd_stack_search_label(char *label) {
 }
 
 /**
- * Parse a user-inputted line and add to general stack if applicable
+ * Lex a user-inputted line into `node` without adding it to the general
+ * stack. No parser state is used, so lines can be lexed on several threads at
+ * once.
+ * @param res_out set to the command of the line, or NULL if it has none
  */
-int32_t parse_user_command(char *input, int32_t input_len) {
+int32_t parse_command_node(char *input, int32_t input_len, stack_node_t *node,
+                           registered_cmd_stack_t **res_out) {
+    parse_error_col = 0;
+    *res_out = NULL;
+
     // Skip empty strings
     if (input_len == 0) return ERR_SUCCESS;
 
+    // Skip indentation before looking for comments
+    int32_t indent = 0;
+    while (indent < input_len && (input[indent] == ' ' || input[indent] == '\t'))
+        indent++;
+
     // Skip shebang lines
-    if (input[0] == '#') return ERR_SUCCESS;
+    if (input[indent] == '#') return ERR_SUCCESS;
 
     // Skip comments
-    if (input_len >= 3 && strncmp(input, "#//", 3) == 0) {
+    if (input_len - indent >= 9 && strncmp(input+indent, "BasilC#//", 9) == 0) {
         return ERR_SUCCESS;
-    } else if (input_len >= 9 && strncmp(input, "BasilC#//", 9) == 0) {
-        return ERR_SUCCESS;
-    }
-
-    // Determine whether command is prefixed with BasilC-
-    bool has_prefix = false;
-    if (strlen(input) > 6 && strncmp(input, "BasilC-", 7) == 0) {
-        has_prefix = true;
     }
 
-    // Search for command in registered command stack
-    char cmd_name[strlen(input)];
-    // Find first parenthesis
-    int32_t paren = str_index_of(input, "(");
-    if (paren == -1) {
-        return ERR_PAREN;
-    }
+    // Split line into command name and argument spans
+    lexed_cmd_t lexed;
+    int32_t result = lex_command(input, input_len, &lexed);
+    if (result != ERR_SUCCESS) return result;
 
-    // Extract command name
-    if (has_prefix) {
-        strncpy(cmd_name, input+7, paren-7);
-        cmd_name[paren-7] = '\0';
-    } else {
-        strncpy(cmd_name, input, paren);
-        cmd_name[paren] = '\0';
-    }
+    // Skip blank lines
+    if (lexed.name.len == 0) return ERR_SUCCESS;
 
     // Search for command in registered command stack
+    char cmd_name[lexed.name.len + 1];
+    strncpy(cmd_name, input+lexed.name.start, lexed.name.len);
+    cmd_name[lexed.name.len] = '\0';
     registered_cmd_stack_t *res = cmd_stack_search_label(cmd_name);
     if (res == NULL) {
+        parse_error_col = lexed.name.start + 1;
         return ERR_INVALID_CMD;
     }
 
     // Confirm number of given arguments with expected number
-    int32_t num_args = get_char_occurances(input, ",");
-    if (num_args != 0) {
-        num_args++;
-    } else if (input_len > paren && input[paren+1] != ')') {
-        num_args++;
+    if (res->num_args >= 0 && lexed.num_args != res->num_args) {
+        parse_error_col = lexed.body.start + 1;
+        return ERR_ARGS;
     }
-    if (res->num_args >= 0 && num_args != res->num_args) {
+    if (res->num_args < -1 && (lexed.num_args > -res->num_args ||
+                               lexed.num_args < -res->num_args - 1)) {
+        parse_error_col = lexed.body.start + 1;
         return ERR_ARGS;
     }
 
-    // Extract arguments if applicable and add to general stack
-    if (res->num_args > 1) {
-        int32_t num_commas = get_char_occurances(input, ",");
-        int32_t paren_end = str_index_of_skip(input, ")", paren);
-
-        // Extract first argument and put into stack
-        strncpy(current_stack->parameters[0], input+paren+1, str_index_of(input, ",")-paren-1);
-
-        // Put in the rest
+    // Extract arguments
+    if (res->num_args == -1) {
+        // -1 was specified which forces the whole body into one argument
+        result = lex_decode_arg(node->parameters[0],
+                                STACK_PARAMETER_MAX_LENGTH, input,
+                                lexed.body, false);
+        if (result != ERR_SUCCESS) return result;
+    } else {
         int32_t i;
-        for (i=0; i<num_commas; i++) {
-            int32_t start = str_index_of_n(input, ",", i)+1;
-            int32_t end = str_index_of_n(input, ",", i+1)-2;
-            if (end == -1 - 2) {
-                end = paren_end - 1;
-            }
-            strncpy(current_stack->parameters[i+1], input+start+1, end-start);
+        for (i=0; i<lexed.num_args; i++) {
+            // Whitespace after a separating comma isn't part of the argument
+            result = lex_decode_arg(node->parameters[i],
+                                    STACK_PARAMETER_MAX_LENGTH, input,
+                                    lexed.args[i], lexed.num_args > 1);
+            if (result != ERR_SUCCESS) return result;
         }
-
-        current_stack->command = res->name;
-
-        goto advance_stack;
-    } else if (res->num_args == 1 || res->num_args == -1) {
-        // Only one argument provided, or -1 was specified which forces 1 arg
-        int32_t paren_end = str_index_of_skip(input, ")", paren);
-        strncpy(current_stack->parameters[0],
-                input+paren+1, paren_end-paren-1);
-        current_stack->command = res->name;
-
-        goto advance_stack;
-    } else {
-        // No arguments, add to stack
-        current_stack->command = res->name;
-        goto advance_stack;
     }
+    node->command = res->name;
+    *res_out = res;
+    return ERR_SUCCESS;
+}
 
-    return false;
-advance_stack:
+/**
+ * Finish parsing the command `res` that was lexed into current_stack, once
+ * all commands before it are done
+ */
+int32_t parse_finish_command(registered_cmd_stack_t *res) {
+    parse_error_col = 0;
     current_stack->execute = !in_block;
     // Handle special parsing commands
     if (res->special_parse != NULL && !(res->special_parse())) {
         return ERR_SPECIAL_PARSE;
     }
-    current_stack->next = malloc(sizeof(stack_node_t));
+    return ERR_SUCCESS;
+}
+
+/**
+ * Parse a user-inputted line and add to general stack if applicable
+ */
+int32_t parse_user_command(char *input, int32_t input_len) {
+    registered_cmd_stack_t *res;
+    int32_t result = parse_command_node(input, input_len, current_stack, &res);
+    if (result != ERR_SUCCESS || res == NULL) return result;
+
+    result = parse_finish_command(res);
+    if (result != ERR_SUCCESS) return result;
+
+    current_stack->next = basilc_malloc(sizeof(stack_node_t), MEM_NODES);
     stack_node_initialize(current_stack->next);
     current_stack = current_stack->next;
     return ERR_SUCCESS;
@@ -201,8 +217,14 @@ bool execute_command(stack_node_t **node) {
         goto increment_stack_node;
     }
 
-    // Call handler function
-    result = res->handle_cmd(node);
+    // Call handler function, timing it for -t
+    if (timing_enabled) {
+        uint64_t start = timing_now();
+        result = res->handle_cmd(node);
+        timing_record(res->name, timing_now() - start);
+    } else {
+        result = res->handle_cmd(node);
+    }
 
 increment_stack_node:
     // If stack wasn't modified by function, increment it to the next one
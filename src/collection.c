@@ -0,0 +1,305 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains maps and arrays, the collection values a variable can
+ * hold instead of a string.
+ *
+ * Both keep their elements in one dense entries array, so arrays grow with
+ * amortized O(1) pushes and maps iterate in insertion order. Maps also keep
+ * an open addressing table of indexes into the entries array, probed
+ * linearly and kept at most half full, so lookups stay O(1) with tens of
+ * thousands of keys. Deleted map entries leave holes that are squeezed out
+ * the next time the entries array is full.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <collection.h>
+#include <stringhelpers.h>
+#include <memstat.h>
+
+#define SLOT_EMPTY -1
+#define SLOT_DELETED -2
+
+collection_t * collection_create(uint8_t kind) {
+    collection_t *coll = basilc_malloc(sizeof(collection_t), MEM_VARS);
+    coll->kind = kind;
+    coll->entries = NULL;
+    coll->num_entries = 0;
+    coll->max_entries = 0;
+    coll->len = 0;
+    coll->slots = NULL;
+    coll->num_slots = 0;
+    return coll;
+}
+
+void collection_free(collection_t *coll) {
+    int32_t i;
+    for (i=0; i<coll->num_entries; i++) {
+        basilc_free(coll->entries[i].key);
+        value_free(&coll->entries[i].value);
+    }
+    basilc_free(coll->entries);
+    basilc_free(coll->slots);
+    basilc_free(coll);
+}
+
+/**
+ * Parse an array index
+ * @return false if `key` isn't a non-negative integer
+ */
+static bool parse_index(char *key, int32_t *index) {
+    char *end;
+    long val = strtol(key, &end, 10);
+    if (end == key || *end != '\0' || val < 0 || val > INT32_MAX) return false;
+    *index = (int32_t) val;
+    return true;
+}
+
+/**
+ * Find the slot of `key` in a map
+ * @return index into slots, which is SLOT_EMPTY if the key isn't present
+ */
+static int32_t find_slot(collection_t *coll, char *key, uint32_t hash) {
+    int32_t mask = coll->num_slots - 1;
+    int32_t i = hash & mask;
+    while (coll->slots[i] != SLOT_EMPTY) {
+        if (coll->slots[i] >= 0) {
+            coll_entry_t *entry = &coll->entries[coll->slots[i]];
+            if (entry->hash == hash && strcmp(entry->key, key) == 0) return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Rebuild the slots of a map for its current entries array
+static void rebuild_slots(collection_t *coll) {
+    int32_t num_slots = 16;
+    while (num_slots < coll->max_entries * 2) num_slots *= 2;
+
+    basilc_free(coll->slots);
+    coll->slots = basilc_malloc(sizeof(int32_t) * num_slots, MEM_VARS);
+    coll->num_slots = num_slots;
+    int32_t i;
+    for (i=0; i<num_slots; i++) coll->slots[i] = SLOT_EMPTY;
+
+    int32_t mask = num_slots - 1;
+    for (i=0; i<coll->num_entries; i++) {
+        int32_t slot = coll->entries[i].hash & mask;
+        while (coll->slots[slot] != SLOT_EMPTY) slot = (slot + 1) & mask;
+        coll->slots[slot] = i;
+    }
+}
+
+// Make room for one more entry at the end of the entries array
+static void reserve_entry(collection_t *coll) {
+    if (coll->num_entries < coll->max_entries) return;
+
+    if (coll->kind == COLL_MAP && coll->len < coll->num_entries / 2) {
+        // Mostly holes: squeeze them out instead of growing
+        int32_t i, live = 0;
+        for (i=0; i<coll->num_entries; i++) {
+            if (coll->entries[i].key != NULL) {
+                coll->entries[live++] = coll->entries[i];
+            } else {
+                value_free(&coll->entries[i].value);
+            }
+        }
+        coll->num_entries = live;
+    } else {
+        coll->max_entries = coll->max_entries ? coll->max_entries * 2 : 8;
+        coll->entries = basilc_realloc(coll->entries, sizeof(coll_entry_t) *
+                                       coll->max_entries, MEM_VARS);
+    }
+
+    if (coll->kind == COLL_MAP) rebuild_slots(coll);
+}
+
+static coll_entry_t * add_entry(collection_t *coll) {
+    reserve_entry(coll);
+    coll_entry_t *entry = &coll->entries[coll->num_entries++];
+    entry->key = NULL;
+    entry->hash = 0;
+    value_init(&entry->value);
+    coll->len++;
+    return entry;
+}
+
+/**
+ * Look up a map key or array index
+ * @return the element's value, or NULL if it doesn't exist
+ */
+value_t * collection_get(collection_t *coll, char *key) {
+    if (coll->kind == COLL_ARRAY) {
+        int32_t index;
+        if (!parse_index(key, &index) || index >= coll->len) return NULL;
+        return &coll->entries[index].value;
+    }
+
+    if (coll->len == 0) return NULL;
+    int32_t slot = find_slot(coll, key, str_hash(key, strlen(key)));
+    if (coll->slots[slot] == SLOT_EMPTY) return NULL;
+    return &coll->entries[coll->slots[slot]].value;
+}
+
+/**
+ * Find or add the element for a map key or array index. An array index may be
+ * one past the end, which adds an element.
+ * @return the element's value, or NULL if the index is out of range
+ */
+value_t * collection_put(collection_t *coll, char *key) {
+    if (coll->kind == COLL_ARRAY) {
+        int32_t index;
+        if (!parse_index(key, &index) || index > coll->len) return NULL;
+        if (index == coll->len) return collection_push(coll);
+        return &coll->entries[index].value;
+    }
+
+    value_t *value = collection_get(coll, key);
+    if (value != NULL) return value;
+
+    coll_entry_t *entry = add_entry(coll);
+    entry->key = basilc_malloc(strlen(key) + 1, MEM_VARS);
+    strcpy(entry->key, key);
+    entry->hash = str_hash(key, strlen(key));
+
+    int32_t slot = find_slot(coll, key, entry->hash);
+    coll->slots[slot] = entry - coll->entries;
+    return &entry->value;
+}
+
+/**
+ * Remove a map key or array index. Later array elements move down by one.
+ * @return false if the element doesn't exist
+ */
+bool collection_del(collection_t *coll, char *key) {
+    if (coll->kind == COLL_ARRAY) {
+        int32_t index;
+        if (!parse_index(key, &index) || index >= coll->len) return false;
+        value_free(&coll->entries[index].value);
+        memmove(&coll->entries[index], &coll->entries[index+1],
+                sizeof(coll_entry_t) * (coll->len - index - 1));
+        coll->num_entries--;
+        coll->len--;
+        return true;
+    }
+
+    if (coll->len == 0) return false;
+    int32_t slot = find_slot(coll, key, str_hash(key, strlen(key)));
+    if (coll->slots[slot] == SLOT_EMPTY) return false;
+
+    coll_entry_t *entry = &coll->entries[coll->slots[slot]];
+    basilc_free(entry->key);
+    entry->key = NULL;
+    value_free(&entry->value);
+    coll->slots[slot] = SLOT_DELETED;
+    coll->len--;
+    return true;
+}
+
+/**
+ * Add an element to the end of an array
+ */
+value_t * collection_push(collection_t *coll) {
+    return &add_entry(coll)->value;
+}
+
+/**
+ * Get element `index` of an array for writing. The index may be one past the
+ * end, which adds an element. Existing elements keep their buffers, so
+ * refilling an array with values of similar size doesn't allocate.
+ */
+value_t * collection_at(collection_t *coll, int32_t index) {
+    if (index == coll->len) return collection_push(coll);
+    return &coll->entries[index].value;
+}
+
+/**
+ * Remove the elements of an array from index `len` on
+ */
+void collection_truncate(collection_t *coll, int32_t len) {
+    int32_t i;
+    for (i=len; i<coll->len; i++) value_free(&coll->entries[i].value);
+    if (len < coll->len) coll->num_entries = coll->len = len;
+}
+
+/**
+ * Get the collection held by a variable
+ * @param kind   COLL_MAP, COLL_ARRAY, or COLL_ANY
+ * @param create whether to turn the variable into an empty collection of
+ *               `kind` if it is missing or holds a string
+ * @return the collection, or NULL if there is none of the requested kind
+ */
+collection_t * collection_of_var(char *name, uint8_t kind, bool create) {
+    variable_stack_node_t *var = var_stack_search_label(name);
+    if (var != NULL && var->coll != NULL) {
+        if (kind != COLL_ANY && var->coll->kind != kind) return NULL;
+        return var->coll;
+    }
+    if (!create) return NULL;
+
+    if (var == NULL) var = define_var(name, "");
+    value_set(&var->value, "", 0);
+    var->coll = collection_create(kind);
+    return var->coll;
+}
+
+/**
+ * Get the array held by a variable to fill it with new elements, turning the
+ * variable into an empty array if it holds anything else
+ */
+collection_t * collection_array_of_var(char *name) {
+    collection_t *coll = collection_of_var(name, COLL_ARRAY, false);
+    if (coll != NULL) return coll;
+
+    define_var(name, "");
+    return collection_of_var(name, COLL_ARRAY, true);
+}
+
+/**
+ * Get the iteration state of an each() node, creating it on first use
+ */
+each_state_t * collection_each_state(stack_node_t *node) {
+    if (node->data == NULL) {
+        each_state_t *state = basilc_malloc(sizeof(each_state_t), MEM_VARS);
+        state->cursor = 0;
+        state->resume = false;
+        node->data = state;
+    }
+    return node->data;
+}
+
+/**
+ * Advance the each(collection, variable) loop at `node`, setting the variable
+ * to the next key of a map or the next element of an array
+ * @param first whether the loop is being entered rather than continued
+ * @return false once there are no elements left
+ */
+bool collection_each(stack_node_t *node, bool first) {
+    each_state_t *state = collection_each_state(node);
+    if (first) state->cursor = 0;
+
+    collection_t *coll = collection_of_var(node->parameters[0], COLL_ANY, false);
+    if (coll == NULL) return false;
+
+    while (state->cursor < coll->num_entries) {
+        coll_entry_t *entry = &coll->entries[state->cursor++];
+        if (coll->kind == COLL_ARRAY) {
+            define_var(node->parameters[1], value_flatten(&entry->value));
+            return true;
+        } else if (entry->key != NULL) {
+            define_var(node->parameters[1], entry->key);
+            return true;
+        }
+    }
+    return false;
+}
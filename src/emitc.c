@@ -0,0 +1,296 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the C backend used by basilc --emit-c. The general stack
+ * is translated into a single C function: labels become C labels, goto()
+ * becomes goto, if()/endif() become an if block, each()/endeach() become a for
+ * loop, while()/endwhile() become a while loop left and continued through
+ * labels, and say() of literals and variables is written out directly.
+ * Variables are looked up once and kept in static slots. All other commands are
+ * run through their handlers in libbasilc.a, see native.c.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <emitc.h>
+
+// Growable list of names, used for labels and variable slots
+struct name_list {
+    char **names;
+    int32_t len;
+    int32_t cap;
+};
+typedef struct name_list name_list_t;
+
+static int32_t name_list_find(name_list_t *list, char *name) {
+    int32_t i;
+    for (i=0; i<list->len; i++) {
+        if (strcmp(list->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int32_t name_list_add(name_list_t *list, char *name) {
+    int32_t i = name_list_find(list, name);
+    if (i > -1) return i;
+
+    if (list->len == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 16;
+        list->names = realloc(list->names, sizeof(char *) * list->cap);
+    }
+    list->names[list->len] = name;
+    return list->len++;
+}
+
+static bool is_command(stack_node_t *node, char *name) {
+    return node->command != NULL && strcmp(node->command, name) == 0;
+}
+
+// Whether a goto() can be translated into a C goto
+static bool is_static_goto(stack_node_t *node, name_list_t *labels) {
+    return is_command(node, "goto") &&
+           name_list_find(labels, node->parameters[0]) > -1;
+}
+
+// Write `str` as a C string literal
+static void emit_string(FILE *out, char *str) {
+    fputc('"', out);
+    for (; *str; str++) {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c == '\n') fputs("\\n", out);
+        else if (c == '\t') fputs("\\t", out);
+        else if (c < 0x20 || c >= 0x7f || c == '?') fprintf(out, "\\%03o", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// Write a string literal for `len` characters of `str`
+static void emit_string_n(FILE *out, char *str, int32_t len) {
+    char temp[len + 1];
+    memcpy(temp, str, len);
+    temp[len] = '\0';
+    emit_string(out, temp);
+}
+
+/**
+ * Find the next $variable in `str`, using the same rules as
+ * parse_var_string(): a variable name ends at the next space.
+ * @return index of the $, or -1 if there is none
+ */
+static int32_t next_var(char *str, int32_t from, int32_t *name_len) {
+    char *dollar = strchr(str + from, '$');
+    if (dollar == NULL) return -1;
+
+    char *end = strchr(dollar, ' ');
+    if (end == NULL) end = dollar + strlen(dollar);
+    *name_len = end - dollar - 1;
+    return dollar - str;
+}
+
+// Whether a break() or continue() inside the while() at `loop` refers to it
+static bool loop_has(stack_node_t *loop, char *cmd) {
+    stack_node_t *cur;
+    for (cur = loop->next; cur != loop->block; cur = cur->next) {
+        if (cur->block == loop && is_command(cur, cmd)) return true;
+    }
+    return false;
+}
+
+// Index of `node` in the general stack starting at `start`
+static int32_t node_index(stack_node_t *start, stack_node_t *node) {
+    int32_t index = 0;
+    for (; start != node; start = start->next) index++;
+    return index;
+}
+
+static void emit_node_decl(FILE *out, stack_node_t *node, int32_t index) {
+    int32_t i;
+    fprintf(out, "static stack_node_t n%d = {\n", index);
+    fprintf(out, "    .command = ");
+    emit_string(out, node->command);
+    fprintf(out, ",\n    .execute = true,\n    .linenum = %d,\n",
+            node->linenum);
+    fprintf(out, "    .parameters = { ");
+    for (i=0; i<STACK_PARAMETER_MAX_AMOUNT; i++) {
+        emit_string(out, node->parameters[i]);
+        fputs(i == STACK_PARAMETER_MAX_AMOUNT-1 ? " },\n" : ", ", out);
+    }
+    fprintf(out, "};\n");
+}
+
+static void emit_say(FILE *out, stack_node_t *node, name_list_t *vars,
+                     char *indent) {
+    char *str = node->parameters[0];
+    int32_t pos, name_len;
+
+    if (next_var(str, 0, &name_len) > -1) {
+        // Every variable has to exist, otherwise the text is printed as is
+        fprintf(out, "%sif (", indent);
+        bool first = true;
+        for (pos = 0; (pos = next_var(str, pos, &name_len)) > -1;
+             pos += name_len + 1) {
+            char name[name_len + 1];
+            memcpy(name, str + pos + 1, name_len);
+            name[name_len] = '\0';
+            int32_t slot = name_list_find(vars, name);
+            fprintf(out, "%snative_bind(&v%d, ", first ? "" : " && ", slot);
+            first = false;
+            emit_string(out, name);
+            fputc(')', out);
+        }
+        fprintf(out, ") {\n");
+
+        int32_t last = 0;
+        for (pos = 0; (pos = next_var(str, pos, &name_len)) > -1;
+             pos += name_len + 1) {
+            char name[name_len + 1];
+            memcpy(name, str + pos + 1, name_len);
+            name[name_len] = '\0';
+            if (pos > last) {
+                fprintf(out, "%s    fputs(", indent);
+                emit_string_n(out, str + last, pos - last);
+                fprintf(out, ", stdout);\n");
+            }
+            fprintf(out, "%s    value_write(&v%d->value, stdout);\n", indent,
+                    name_list_find(vars, name));
+            last = pos + name_len + 1;
+        }
+        if (str[last]) {
+            fprintf(out, "%s    fputs(", indent);
+            emit_string(out, str + last);
+            fprintf(out, ", stdout);\n");
+        }
+        fprintf(out, "%s} else {\n%s    fputs(", indent, indent);
+        emit_string(out, str);
+        fprintf(out, ", stdout);\n%s}\n", indent);
+    } else if (str[0]) {
+        fprintf(out, "%sfputs(", indent);
+        emit_string(out, str);
+        fprintf(out, ", stdout);\n");
+    }
+
+    if (is_command(node, "sayln")) fprintf(out, "%sputchar('\\n');\n", indent);
+}
+
+/**
+ * Translate the general stack starting at `start` into a C program
+ */
+void emit_c_program(FILE *out, stack_node_t *start, char *source_name) {
+    name_list_t labels = {0};
+    name_list_t vars = {0};
+    stack_node_t *cur;
+    int32_t index;
+
+    // Collect labels and variables
+    for (cur = start; cur->command != NULL; cur = cur->next) {
+        if (is_command(cur, "parallel") || is_command(cur, "pareach") ||
+            is_command(cur, "call")) {
+            // The generated program has no thread pool or return stack
+            char error[80];
+            sprintf(error, "%s() at line %d can't be compiled to C",
+                    cur->command, cur->linenum);
+            exit_with_error(error);
+        } else if (is_command(cur, "label")) {
+            name_list_add(&labels, cur->parameters[0]);
+        } else if (is_command(cur, "define")) {
+            name_list_add(&vars, cur->parameters[0]);
+        } else if (is_command(cur, "say") || is_command(cur, "sayln")) {
+            char *str = cur->parameters[0];
+            int32_t pos, name_len;
+            for (pos = 0; (pos = next_var(str, pos, &name_len)) > -1;
+                 pos += name_len + 1) {
+                char *name = malloc(name_len + 1);
+                memcpy(name, str + pos + 1, name_len);
+                name[name_len] = '\0';
+                name_list_add(&vars, name);
+            }
+        }
+    }
+
+    fprintf(out, "/* Generated by basilc --emit-c from %s */\n\n", source_name);
+    fprintf(out, "#include <stdio.h>\n#include <stdbool.h>\n\n");
+    fprintf(out, "#include <main.h>\n#include <engine.h>\n#include <native.h>\n");
+    fprintf(out, "#include <collection.h>\n\n");
+
+    // Nodes that are handed to handlers
+    for (cur = start, index = 0; cur->command != NULL; cur = cur->next, index++) {
+        if (is_command(cur, "label") || is_command(cur, "endif") ||
+            is_command(cur, "endeach") || is_command(cur, "say") || is_command(cur, "sayln") ||
+            is_command(cur, "endwhile") || is_command(cur, "break") ||
+            is_command(cur, "continue") || is_static_goto(cur, &labels)) continue;
+        emit_node_decl(out, cur, index);
+    }
+    fputc('\n', out);
+
+    // Variable slots
+    int32_t i;
+    for (i=0; i<vars.len; i++) {
+        fprintf(out, "static variable_stack_node_t *v%d;\n", i);
+    }
+
+    fprintf(out, "\nint main(int argc, char **argv) {\n");
+    fprintf(out, "    native_init(argc, argv);\n\n");
+
+    int32_t depth = 1;
+    for (cur = start, index = 0; cur->command != NULL; cur = cur->next, index++) {
+        if (is_command(cur, "endif") || is_command(cur, "endeach") ||
+            is_command(cur, "endwhile")) depth--;
+        char indent[depth * 4 + 1];
+        memset(indent, ' ', depth * 4);
+        indent[depth * 4] = '\0';
+        fprintf(out, "%s// line %d: %s()\n", indent, cur->linenum,
+                cur->command);
+
+        if (is_command(cur, "label")) {
+            fprintf(out, "L%d: ;\n", name_list_find(&labels, cur->parameters[0]));
+        } else if (is_static_goto(cur, &labels)) {
+            fprintf(out, "%sgoto L%d;\n", indent,
+                    name_list_find(&labels, cur->parameters[0]));
+        } else if (is_command(cur, "if")) {
+            fprintf(out, "%sif (engine_eval_if(&n%d)) {\n", indent, index);
+            depth++;
+        } else if (is_command(cur, "endif") || is_command(cur, "endeach")) {
+            fprintf(out, "%s}\n", indent);
+        } else if (is_command(cur, "while")) {
+            fprintf(out, "%swhile (engine_eval_if(&n%d)) {\n", indent, index);
+            depth++;
+        } else if (is_command(cur, "endwhile")) {
+            // Labels are only written when used, so the output has no warnings
+            int32_t loop = node_index(start, cur->block);
+            if (loop_has(cur->block, "continue"))
+                fprintf(out, "C%d: ;\n", loop);
+            fprintf(out, "%s}\n", indent);
+            if (loop_has(cur->block, "break"))
+                fprintf(out, "B%d: ;\n", loop);
+        } else if (is_command(cur, "break")) {
+            fprintf(out, "%sgoto B%d;\n", indent, node_index(start, cur->block));
+        } else if (is_command(cur, "continue")) {
+            fprintf(out, "%sgoto C%d;\n", indent, node_index(start, cur->block));
+        } else if (is_command(cur, "each")) {
+            fprintf(out, "%sfor (bool e%d = true; collection_each(&n%d, e%d); "
+                    "e%d = false) {\n", indent, index, index, index, index);
+            depth++;
+        } else if (is_command(cur, "say") || is_command(cur, "sayln")) {
+            emit_say(out, cur, &vars, indent);
+        } else if (is_command(cur, "import")) {
+            fprintf(out, "%snative_import(&n%d);\n", indent, index);
+        } else if (is_command(cur, "define")) {
+            fprintf(out, "%snative_define(&v%d, &n%d);\n", indent,
+                    name_list_find(&vars, cur->parameters[0]), index);
+        } else {
+            fprintf(out, "%snative_exec(&n%d);\n", indent, index);
+        }
+    }
+
+    fprintf(out, "\n    return native_exit();\n}\n");
+}
@@ -0,0 +1,328 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the threaded execution engine. The general stack is
+ * compiled into a flat array of instructions with all jump targets resolved,
+ * and commands that do nothing at runtime (label(), endif(), commands without
+ * a handler) are left out entirely. Common pairs of commands are fused into
+ * superinstructions. Instructions are dispatched with computed goto when the
+ * compiler supports it, and with a switch otherwise.
+ *
+ * if() is compiled into a conditional jump past its endif(), which is the
+ * behavior documented in the manpage. while() is compiled the same way, with
+ * a jump past its endwhile(), and endwhile(), break() and continue() become
+ * plain jumps, so a loop costs one condition and one jump per iteration.
+ *
+ * With -t, every command other than if() and while() is compiled into a
+ * generic call so that its handler can be timed, which also leaves --jit
+ * without loops to compile.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <engine.h>
+#include <jit.h>
+#include <linereader.h>
+#include <sample.h>
+#include <governor.h>
+#include <memstat.h>
+#include <timing.h>
+#include <callstack.h>
+
+static bool is_command(stack_node_t *node, char *name) {
+    return node->command != NULL && strcmp(node->command, name) == 0;
+}
+
+// Whether a node is compiled into an OP_GOTO
+static bool is_jump(stack_node_t *node) {
+    return is_command(node, "goto") || is_command(node, "endwhile") ||
+           is_command(node, "break") || is_command(node, "continue");
+}
+
+static bool is_literal(char *param) {
+    return strchr(param, '$') == NULL;
+}
+
+// Evaluate the condition of an if() or while() node the same way
+// basilc_if_callback does
+bool engine_eval_if(stack_node_t *node) {
+    bool cond;
+    uint64_t start = timing_enabled ? timing_now() : 0;
+    cond = eval_node_conditional(node);
+    if (timing_enabled) timing_record(node->command, timing_now() - start);
+    return cond;
+}
+
+static void engine_fail(stack_node_t *node) {
+    char error[80];
+    sprintf(error, "Failed to execute command: %s", node->command);
+    exit_with_error(error);
+}
+
+/**
+ * Call the handler of a generic instruction
+ * @return index of the instruction to execute next
+ */
+int32_t engine_call(insn_t *insn) {
+    stack_node_t *node = insn->node;
+    if (timing_enabled) {
+        uint64_t start = timing_now();
+        bool result = insn->handle_cmd(&node);
+        timing_record(insn->node->command, timing_now() - start);
+        if (!result) engine_fail(insn->node);
+    } else if (!insn->handle_cmd(&node)) {
+        engine_fail(insn->node);
+    }
+
+    // The handler signals a jump by changing the node
+    return (node == insn->node) ? insn->node->pc + 1 : node->pc;
+}
+
+/**
+ * Compile the general stack starting at `start` into a program.
+ * Every node's pc is set to the instruction that executes it, or for nodes
+ * that compile to nothing, to the next instruction that is executed.
+ */
+program_t * engine_compile(stack_node_t *start) {
+    stack_node_t *cur;
+    int32_t len = 1; // Room for the final OP_HALT
+    for (cur = start; cur != NULL && cur->command != NULL; cur = cur->next) {
+        len++;
+    }
+
+    program_t *prog = basilc_malloc(sizeof(program_t), MEM_CODE);
+    prog->code = basilc_malloc(sizeof(insn_t) * len, MEM_CODE);
+    prog->len = 0;
+
+    // First pass: select opcodes and assign pcs
+    for (cur = start; cur != NULL; cur = cur->next) {
+        cur->pc = prog->len;
+        if (cur->command == NULL) break;
+
+        registered_cmd_stack_t *res = cmd_stack_search_label(cur->command);
+        if (res == NULL || res->handle_cmd == NULL) continue;
+
+        insn_t *insn = &prog->code[prog->len++];
+        insn->node = cur;
+        insn->handle_cmd = res->handle_cmd;
+        insn->target = -1;
+        insn->hotness = 0;
+        insn->native = NULL;
+
+        bool conditional = is_command(cur, "if") || is_command(cur, "while");
+        if (timing_enabled && !conditional) {
+            insn->op = OP_CALL;
+        } else if (is_command(cur, "say") && is_literal(cur->parameters[0])) {
+            insn->op = OP_SAY;
+        } else if (is_command(cur, "sayln") && is_literal(cur->parameters[0])) {
+            insn->op = OP_SAYLN;
+        } else if (is_command(cur, "define")) {
+            insn->op = OP_DEFINE;
+        } else if (is_jump(cur)) {
+            insn->op = OP_GOTO;
+        } else if (conditional) {
+            insn->op = OP_IF;
+        } else {
+            insn->op = OP_CALL;
+        }
+    }
+    prog->code[prog->len].op = OP_HALT;
+    prog->code[prog->len].node = cur;
+    prog->code[prog->len].native = NULL;
+    prog->len++;
+
+    // Second pass: resolve jump targets
+    int32_t i;
+    for (i=0; i<prog->len; i++) {
+        insn_t *insn = &prog->code[i];
+        stack_node_t *node = insn->node;
+        if (insn->op == OP_GOTO && is_command(node, "endwhile")) {
+            insn->target = node->block->pc;
+        } else if (insn->op == OP_GOTO && is_command(node, "break")) {
+            insn->target = node->block->block->next->pc;
+        } else if (insn->op == OP_GOTO && is_command(node, "continue")) {
+            insn->target = node->block->pc;
+        } else if (insn->op == OP_GOTO) {
+            stack_node_t *label = stack_search_label(insn->node->parameters[0]);
+            if (label != NULL) {
+                insn->target = label->pc;
+            } else {
+                // Let the handler report the missing label at runtime
+                insn->op = OP_CALL;
+            }
+        } else if (insn->op == OP_IF && is_command(node, "while")) {
+            insn->target = node->block->next->pc;
+        } else if (insn->op == OP_IF) {
+            for (cur = insn->node->next; cur->command != NULL; cur = cur->next) {
+                if (is_command(cur, "endif")) break;
+            }
+            insn->target = cur->pc;
+        }
+    }
+
+    // Third pass: fuse adjacent pairs into superinstructions. The second
+    // instruction of a pair is kept so that it can still be jumped to.
+    for (i=0; i<prog->len-1; i++) {
+        insn_t *insn = &prog->code[i];
+        insn_t *next = &prog->code[i+1];
+        if (insn->node->next != next->node) continue;
+
+        if (insn->op == OP_SAY && next->op == OP_SAYLN) {
+            insn->op = OP_SAY_SAYLN;
+        } else if (insn->op == OP_DEFINE && next->op == OP_GOTO) {
+            insn->op = OP_DEFINE_GOTO;
+        }
+    }
+
+    return prog;
+}
+
+/**
+ * Execute a compiled program
+ */
+void engine_execute(program_t *prog) {
+    insn_t *code = prog->code;
+    insn_t *ip = code;
+    insn_t *next;
+    stack_node_t *node;
+    uint64_t insns = 0; // Added to governor_insns on backward jumps
+
+#ifdef ENGINE_THREADED
+    static void *dispatch_table[OP_NUM_OPCODES] = {
+        [OP_HALT] = &&do_OP_HALT,
+        [OP_CALL] = &&do_OP_CALL,
+        [OP_SAY] = &&do_OP_SAY,
+        [OP_SAYLN] = &&do_OP_SAYLN,
+        [OP_SAY_SAYLN] = &&do_OP_SAY_SAYLN,
+        [OP_DEFINE] = &&do_OP_DEFINE,
+        [OP_DEFINE_GOTO] = &&do_OP_DEFINE_GOTO,
+        [OP_GOTO] = &&do_OP_GOTO,
+        [OP_IF] = &&do_OP_IF,
+    };
+// The node is published for the sampling profiler before every instruction
+#define TARGET(op) do_##op:
+#define DISPATCH() sample_node = ip->node; insns++; \
+                   goto *dispatch_table[ip->op]
+#else
+#define TARGET(op) case op:
+#define DISPATCH() goto dispatch
+#endif
+
+// Resource limits are only checked on backward jumps, see governor.c
+#define BACKWARD_EDGE() \
+    if (governor_active) { \
+        governor_insns += insns; \
+        insns = 0; \
+        governor_check(); \
+    }
+
+#ifdef ENGINE_THREADED
+    DISPATCH();
+#else
+dispatch:
+    sample_node = ip->node;
+    insns++;
+    switch (ip->op) {
+#endif
+    TARGET(OP_CALL)
+        next = code + engine_call(ip);
+        if (next <= ip) BACKWARD_EDGE();
+        ip = next;
+        DISPATCH();
+
+    TARGET(OP_SAY)
+        fputs(ip->node->parameters[0], stdout);
+        ip++;
+        DISPATCH();
+
+    TARGET(OP_SAYLN)
+        fputs(ip->node->parameters[0], stdout);
+        putchar('\n');
+        ip++;
+        DISPATCH();
+
+    TARGET(OP_SAY_SAYLN)
+        fputs(ip->node->parameters[0], stdout);
+        fputs(ip[1].node->parameters[0], stdout);
+        putchar('\n');
+        ip += 2;
+        DISPATCH();
+
+    TARGET(OP_DEFINE)
+        node = ip->node;
+        ip->handle_cmd(&node);
+        ip++;
+        DISPATCH();
+
+    TARGET(OP_DEFINE_GOTO)
+        node = ip->node;
+        ip->handle_cmd(&node);
+        ip++;
+        // Fall into the goto() this instruction was fused with
+    TARGET(OP_GOTO)
+        if (ip->target <= ip - code) {
+            BACKWARD_EDGE();
+            if (jit_enabled) {
+                ip = code + jit_backward_edge(prog, ip);
+                DISPATCH();
+            }
+        }
+        ip = code + ip->target;
+        DISPATCH();
+
+    TARGET(OP_IF)
+        ip = engine_eval_if(ip->node) ? ip + 1 : code + ip->target;
+        DISPATCH();
+
+    TARGET(OP_HALT)
+        governor_insns += insns;
+        return;
+#ifndef ENGINE_THREADED
+    default:
+        return;
+    }
+#endif
+
+#undef TARGET
+#undef DISPATCH
+#undef BACKWARD_EDGE
+}
+
+/**
+ * Run a compiled program once for every line of stdin, with the line in the
+ * variable `line` and its number in `linenum`. Variables and calls are
+ * reset before every line. With `print`, the line is printed after every
+ * run, including any changes the program made to it.
+ */
+void engine_execute_lines(program_t *prog, bool print) {
+    line_reader_t *reader = reader_create(stdin);
+    char *text;
+    size_t len;
+    uint64_t linenum = 0;
+    while ((text = reader_next_line(reader, &len)) != NULL) {
+        char num[24];
+        sprintf(num, "%llu", (unsigned long long) ++linenum);
+        reset_vars();
+        call_reset();
+        define_var("line", text);
+        define_var("linenum", num);
+
+        engine_execute(prog);
+
+        if (print) {
+            variable_stack_node_t *var = var_stack_search_label("line");
+            if (var != NULL) value_write(&var->value, stdout);
+            putchar('\n');
+        }
+    }
+    reader_free(reader);
+}
@@ -0,0 +1,486 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the expressions of if(), while() and let(). An
+ * expression is compiled once, by a recursive descent parser, into reverse
+ * polish instructions, and parts with only literal operands are folded into
+ * a single constant while compiling. It is evaluated on a fixed-size stack,
+ * reading variables in place, so evaluating never allocates.
+ *
+ * Operators, from lowest to highest precedence:
+ *   ||   &&   = == !=   < > <= >=   + -   * / %   unary ! -
+ * Operands are integers, $variables, words and 'quoted strings'. Values are
+ * compared as numbers if both are integers and as strings otherwise, while
+ * arithmetic treats text like atoi() does. && and || only evaluate their
+ * right side if needed.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <expr.h>
+#include <memstat.h>
+
+struct compiler {
+    char *pos; // Next character of the text
+    expr_insn_t code[EXPR_MAX_INSNS];
+    int32_t len;
+    int32_t barrier; // Jump target, so instructions before it can't be folded
+    char *strings; // Names and literals, NUL separated
+    int32_t strings_len;
+    char *error;
+};
+typedef struct compiler compiler_t;
+
+static int64_t to_num(expr_value_t *v) {
+    return v->is_num ? v->num : strtoll(v->str, NULL, 10);
+}
+
+static bool is_integer(expr_value_t *v) {
+    if (v->is_num) return true;
+    char *end;
+    strtoll(v->str, &end, 10);
+    return end != v->str && *end == '\0';
+}
+
+static void set_num(expr_value_t *v, int64_t num) {
+    v->is_num = true;
+    v->num = num;
+    v->str = NULL;
+}
+
+/**
+ * Whether a value counts as true: numbers other than 0, and text that isn't
+ * empty or a zero
+ */
+bool expr_truthy(expr_value_t *value) {
+    if (value->is_num) return value->num != 0;
+    if (is_integer(value)) return to_num(value) != 0;
+    return value->str[0] != '\0';
+}
+
+static int32_t compare(expr_value_t *a, expr_value_t *b) {
+    if (is_integer(a) && is_integer(b)) {
+        int64_t x = to_num(a), y = to_num(b);
+        return (x > y) - (x < y);
+    }
+
+    char a_buf[24], b_buf[24];
+    expr_format(a, a_buf, sizeof(a_buf));
+    expr_format(b, b_buf, sizeof(b_buf));
+    return strcmp(a->is_num ? a_buf : a->str, b->is_num ? b_buf : b->str);
+}
+
+/**
+ * Apply an operator to the top one or two values. `r` may be the same as `a`.
+ * Arithmetic wraps around instead of overflowing.
+ * @return false on a division by zero
+ */
+static bool apply(uint8_t op, expr_value_t *a, expr_value_t *b,
+                  expr_value_t *r) {
+    int64_t x, y;
+    switch (op) {
+    case EXPR_NEG:
+        set_num(r, (int64_t) (0 - (uint64_t) to_num(a)));
+        return true;
+    case EXPR_NOT:
+        set_num(r, !expr_truthy(a));
+        return true;
+    case EXPR_BOOL:
+        set_num(r, expr_truthy(a));
+        return true;
+    case EXPR_EQ: set_num(r, compare(a, b) == 0); return true;
+    case EXPR_NE: set_num(r, compare(a, b) != 0); return true;
+    case EXPR_LT: set_num(r, compare(a, b) < 0); return true;
+    case EXPR_GT: set_num(r, compare(a, b) > 0); return true;
+    case EXPR_LE: set_num(r, compare(a, b) <= 0); return true;
+    case EXPR_GE: set_num(r, compare(a, b) >= 0); return true;
+    }
+
+    x = to_num(a);
+    y = to_num(b);
+    switch (op) {
+    case EXPR_ADD: set_num(r, (int64_t) ((uint64_t) x + (uint64_t) y)); break;
+    case EXPR_SUB: set_num(r, (int64_t) ((uint64_t) x - (uint64_t) y)); break;
+    case EXPR_MUL: set_num(r, (int64_t) ((uint64_t) x * (uint64_t) y)); break;
+    case EXPR_DIV:
+        if (y == 0) return false;
+        set_num(r, y == -1 ? (int64_t) (0 - (uint64_t) x) : x / y);
+        break;
+    case EXPR_MOD:
+        if (y == 0) return false;
+        set_num(r, y == -1 ? 0 : x % y);
+        break;
+    }
+    return true;
+}
+
+static bool is_unary(uint8_t op) {
+    return op == EXPR_NEG || op == EXPR_NOT || op == EXPR_BOOL;
+}
+
+static bool is_constant(compiler_t *c, int32_t i) {
+    return i >= c->barrier &&
+           (c->code[i].op == EXPR_NUM || c->code[i].op == EXPR_STR);
+}
+
+static void load_constant(expr_insn_t *insn, expr_value_t *v) {
+    v->is_num = insn->op == EXPR_NUM;
+    v->num = insn->num;
+    v->str = insn->str;
+}
+
+static expr_insn_t * emit(compiler_t *c, uint8_t op) {
+    if (c->len == EXPR_MAX_INSNS) {
+        c->error = "Expression too long";
+        return &c->code[0];
+    }
+    expr_insn_t *insn = &c->code[c->len++];
+    memset(insn, 0, sizeof(expr_insn_t));
+    insn->op = op;
+    return insn;
+}
+
+static void emit_num(compiler_t *c, int64_t num) {
+    emit(c, EXPR_NUM)->num = num;
+}
+
+// Emit an operator, folding it if all of its operands are constants
+static void emit_op(compiler_t *c, uint8_t op) {
+    int32_t arity = is_unary(op) ? 1 : 2;
+    if (c->len >= arity && is_constant(c, c->len - arity) &&
+        is_constant(c, c->len - 1)) {
+        expr_value_t a, b, r;
+        load_constant(&c->code[c->len - arity], &a);
+        load_constant(&c->code[c->len - 1], &b);
+        // A division by zero is left to fail when it is evaluated
+        if (apply(op, &a, &b, &r)) {
+            c->len -= arity;
+            emit_num(c, r.num);
+            return;
+        }
+    }
+    emit(c, op);
+}
+
+static void skip_blanks(compiler_t *c) {
+    while (*c->pos == ' ' || *c->pos == '\t') c->pos++;
+}
+
+// Consume the operator `tok` if it comes next
+static bool accept(compiler_t *c, char *tok) {
+    skip_blanks(c);
+    size_t len = strlen(tok);
+    if (strncmp(c->pos, tok, len) != 0) return false;
+    c->pos += len;
+    return true;
+}
+
+static bool is_word_char(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+           (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+// Copy `len` characters into the strings of the expression
+static char * add_string(compiler_t *c, char *str, int32_t len) {
+    char *copy = c->strings + c->strings_len;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    c->strings_len += len + 1;
+    return copy;
+}
+
+static void parse_or(compiler_t *c);
+
+static void parse_primary(compiler_t *c) {
+    skip_blanks(c);
+    char *start = c->pos;
+    if (*start >= '0' && *start <= '9') {
+        emit_num(c, strtoll(start, &c->pos, 10));
+    } else if (*start == '$') {
+        for (c->pos++; is_word_char(*c->pos); c->pos++);
+        if (c->pos == start + 1) {
+            c->error = "Missing variable name";
+            return;
+        }
+        emit(c, EXPR_VAR)->str = add_string(c, start + 1, c->pos - start - 1);
+    } else if (*start == '\'') {
+        char *end = strchr(start + 1, '\'');
+        if (end == NULL) {
+            c->error = "Unterminated string";
+            return;
+        }
+        emit(c, EXPR_STR)->str = add_string(c, start + 1, end - start - 1);
+        c->pos = end + 1;
+    } else if (is_word_char(*start)) {
+        for (; is_word_char(*c->pos); c->pos++);
+        emit(c, EXPR_STR)->str = add_string(c, start, c->pos - start);
+    } else if (accept(c, "(")) {
+        parse_or(c);
+        if (!c->error && !accept(c, ")")) c->error = "Missing )";
+    } else {
+        c->error = "Expected a value";
+    }
+}
+
+static void parse_unary(compiler_t *c) {
+    if (accept(c, "!")) {
+        parse_unary(c);
+        emit_op(c, EXPR_NOT);
+    } else if (accept(c, "-")) {
+        parse_unary(c);
+        emit_op(c, EXPR_NEG);
+    } else {
+        parse_primary(c);
+    }
+}
+
+static void parse_mul(compiler_t *c) {
+    parse_unary(c);
+    while (!c->error) {
+        uint8_t op;
+        if (accept(c, "*")) op = EXPR_MUL;
+        else if (accept(c, "/")) op = EXPR_DIV;
+        else if (accept(c, "%")) op = EXPR_MOD;
+        else return;
+        parse_unary(c);
+        emit_op(c, op);
+    }
+}
+
+static void parse_add(compiler_t *c) {
+    parse_mul(c);
+    while (!c->error) {
+        uint8_t op;
+        if (accept(c, "+")) op = EXPR_ADD;
+        else if (accept(c, "-")) op = EXPR_SUB;
+        else return;
+        parse_mul(c);
+        emit_op(c, op);
+    }
+}
+
+static void parse_rel(compiler_t *c) {
+    parse_add(c);
+    while (!c->error) {
+        uint8_t op;
+        if (accept(c, "<=")) op = EXPR_LE;
+        else if (accept(c, ">=")) op = EXPR_GE;
+        else if (accept(c, "<")) op = EXPR_LT;
+        else if (accept(c, ">")) op = EXPR_GT;
+        else return;
+        parse_add(c);
+        emit_op(c, op);
+    }
+}
+
+static void parse_eq(compiler_t *c) {
+    parse_rel(c);
+    while (!c->error) {
+        uint8_t op;
+        if (accept(c, "==") || accept(c, "=")) op = EXPR_EQ;
+        else if (accept(c, "!=")) op = EXPR_NE;
+        else return;
+        parse_rel(c);
+        emit_op(c, op);
+    }
+}
+
+/**
+ * Parse the right side of && or || after the left one, which ends at
+ * `left`. A constant left side either decides the result or is dropped.
+ */
+static void parse_logic(compiler_t *c, uint8_t op, void (*parse)(compiler_t *)) {
+    int32_t left = c->len;
+    bool left_constant = is_constant(c, left - 1);
+    int32_t jump = c->len;
+    emit(c, op);
+    parse(c);
+    emit_op(c, EXPR_BOOL);
+    if (c->error) return;
+
+    if (!left_constant) {
+        c->code[jump].target = c->len;
+        c->barrier = c->len;
+        return;
+    }
+
+    expr_value_t value;
+    load_constant(&c->code[left - 1], &value);
+    if (expr_truthy(&value) == (op == EXPR_OR)) {
+        // true || x and false && x
+        c->len = left - 1;
+        if (c->barrier > c->len) c->barrier = c->len;
+        emit_num(c, op == EXPR_OR);
+    } else {
+        // true && x and false || x are x
+        memmove(&c->code[left - 1], &c->code[left + 1],
+                sizeof(expr_insn_t) * (c->len - left - 1));
+        c->len -= 2;
+        int32_t i;
+        for (i=left-1; i<c->len; i++) {
+            if (c->code[i].op == EXPR_AND || c->code[i].op == EXPR_OR)
+                c->code[i].target -= 2;
+        }
+        if (c->barrier > left) c->barrier -= 2;
+    }
+}
+
+static void parse_and(compiler_t *c) {
+    parse_eq(c);
+    while (!c->error && accept(c, "&&")) parse_logic(c, EXPR_AND, parse_eq);
+}
+
+static void parse_or(compiler_t *c) {
+    parse_and(c);
+    while (!c->error && accept(c, "||")) parse_logic(c, EXPR_OR, parse_and);
+}
+
+/**
+ * Compile an expression
+ * @param error set to a description of the problem if it is invalid
+ * @return the expression, to be freed with basilc_free(), or NULL if it is
+ *         invalid
+ */
+expr_t * expr_compile(char *text, char **error) {
+    char strings[strlen(text) + 1];
+    compiler_t c;
+    c.pos = text;
+    c.len = 0;
+    c.barrier = 0;
+    c.strings = strings;
+    c.strings_len = 0;
+    c.error = NULL;
+
+    parse_or(&c);
+    skip_blanks(&c);
+    if (!c.error && *c.pos != '\0') c.error = "Unexpected text";
+
+    // Jumps only go forward, to where the stack is as deep as before them
+    int32_t i, depth = 0;
+    for (i=0; i<c.len && !c.error; i++) {
+        uint8_t op = c.code[i].op;
+        if (op == EXPR_NUM || op == EXPR_STR || op == EXPR_VAR) depth++;
+        else if (!is_unary(op)) depth--;
+        if (depth > EXPR_STACK_MAX) c.error = "Expression too complex";
+    }
+    if (c.error) {
+        *error = c.error;
+        return NULL;
+    }
+
+    expr_t *expr = basilc_malloc(sizeof(expr_t) + sizeof(expr_insn_t) * c.len +
+                                 c.strings_len, MEM_CODE);
+    expr->len = c.len;
+    memcpy(expr->code, c.code, sizeof(expr_insn_t) * c.len);
+    char *copy = (char *) &expr->code[c.len];
+    memcpy(copy, strings, c.strings_len);
+    for (i=0; i<c.len; i++) {
+        if (expr->code[i].str != NULL)
+            expr->code[i].str = copy + (expr->code[i].str - strings);
+    }
+    return expr;
+}
+
+/**
+ * Evaluate a compiled expression. Text in the result points into a variable
+ * or the expression, and is only valid until either changes.
+ */
+void expr_eval(expr_t *expr, expr_value_t *result) {
+    expr_value_t stack[EXPR_STACK_MAX];
+    int32_t sp = 0;
+    int32_t pc;
+    for (pc = 0; pc < expr->len; pc++) {
+        expr_insn_t *insn = &expr->code[pc];
+        variable_stack_node_t *var;
+        switch (insn->op) {
+        case EXPR_NUM:
+            set_num(&stack[sp++], insn->num);
+            break;
+        case EXPR_STR:
+            stack[sp].is_num = false;
+            stack[sp++].str = insn->str;
+            break;
+        case EXPR_VAR:
+            // Missing variables are empty
+            var = var_stack_search_label(insn->str);
+            stack[sp].is_num = false;
+            stack[sp++].str = var != NULL ? value_flatten(&var->value) : "";
+            break;
+        case EXPR_AND:
+        case EXPR_OR:
+            if (expr_truthy(&stack[sp-1]) == (insn->op == EXPR_OR)) {
+                set_num(&stack[sp-1], insn->op == EXPR_OR);
+                pc = insn->target - 1;
+            } else {
+                sp--;
+            }
+            break;
+        default:
+            if (!is_unary(insn->op)) sp--;
+            if (!apply(insn->op, &stack[sp-1], &stack[sp], &stack[sp-1]))
+                exit_with_error("Division by zero!");
+            break;
+        }
+    }
+    *result = stack[0];
+}
+
+/**
+ * Whether an expression has the same value every time, such as 2 > 1
+ */
+bool expr_is_constant(expr_t *expr) {
+    return expr->len == 1 &&
+           (expr->code[0].op == EXPR_NUM || expr->code[0].op == EXPR_STR);
+}
+
+/**
+ * Write a value as text
+ */
+void expr_format(expr_value_t *value, char *buf, size_t len) {
+    if (value->is_num)
+        snprintf(buf, len, "%lld", (long long) value->num);
+    else
+        snprintf(buf, len, "%s", value->str);
+}
+
+/**
+ * Get the expression in a parameter of a node, which special parsing keeps
+ * in its data field. Nodes made without parsing, like those of --emit-c,
+ * compile it on first use.
+ */
+expr_t * expr_of_node(stack_node_t *node, int32_t param) {
+    if (node->data != NULL) return node->data;
+
+    char *error;
+    node->data = expr_compile(node->parameters[param], &error);
+    if (node->data == NULL) {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "%s in %s() at line %d!", error,
+                 node->command, node->linenum);
+        exit_with_error(msg);
+    }
+    return node->data;
+}
+
+/**
+ * Compile the expression in a parameter of the node being parsed
+ * @return false, after printing the problem, if it is invalid
+ */
+bool expr_parse_node(int32_t param) {
+    char *error;
+    current_stack->data = expr_compile(current_stack->parameters[param],
+                                       &error);
+    if (current_stack->data == NULL) {
+        printf("%s in expression!\n", error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the resource governor behind --max-insns, --timeout and
+ * --max-mem, which embedders set up with governor_set_limits().
+ *
+ * The execution loops count executed commands in governor_insns and call
+ * governor_check() on backward jumps only, which is enough to stop any
+ * loop. The deadline is an ITIMER_REAL timer whose handler just sets a flag
+ * for the next check. The memory cap is enforced by the counting allocator
+ * in memstat.c on every allocation.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include <main.h>
+#include <governor.h>
+#include <sample.h>
+#include <memstat.h>
+
+#ifdef __unix__
+#include <sys/time.h>
+#endif
+
+bool governor_active;
+uint64_t governor_insns;
+
+static basilc_limits_t limits;
+static volatile sig_atomic_t deadline_passed;
+
+static void governor_exceeded(int32_t limit, char *what, uint64_t amount) {
+    // Don't trip again while shutting down
+    governor_active = false;
+    memstat_limit = 0;
+
+    if (limits.on_exceeded != NULL) limits.on_exceeded(limit);
+
+    fflush(stdout);
+    stack_node_t *node = sample_node;
+    if (node != NULL && node->linenum > 0) {
+        fprintf(stderr, "\n[limit] %s limit of %llu exceeded at line %d\n",
+                what, (unsigned long long) amount, node->linenum);
+    } else {
+        fprintf(stderr, "\n[limit] %s limit of %llu exceeded\n", what,
+                (unsigned long long) amount);
+    }
+    exit(GOVERNOR_EXIT_CODE);
+}
+
+static void governor_memory_exceeded(size_t total) {
+    (void) total;
+    governor_exceeded(LIMIT_MEM, "memory", limits.max_mem);
+}
+
+#ifdef __unix__
+static void deadline_handler(int sig) {
+    (void) sig;
+    deadline_passed = 1;
+}
+#endif
+
+/**
+ * Set the limits for the rest of the run. A memory cap has to be set before
+ * anything is allocated through basilc_malloc().
+ */
+void governor_set_limits(basilc_limits_t *new_limits) {
+    limits = *new_limits;
+    governor_insns = 0;
+    deadline_passed = 0;
+    governor_active = limits.max_insns > 0 || limits.timeout_ms > 0;
+
+    if (limits.max_mem > 0) {
+        memstat_set_limit(limits.max_mem, governor_memory_exceeded);
+    }
+
+#ifdef __unix__
+    if (limits.timeout_ms > 0) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = deadline_handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGALRM, &action, NULL);
+
+        struct itimerval timer;
+        memset(&timer, 0, sizeof(timer));
+        timer.it_value.tv_sec = limits.timeout_ms / 1000;
+        timer.it_value.tv_usec = (limits.timeout_ms % 1000) * 1000;
+        setitimer(ITIMER_REAL, &timer, NULL);
+    }
+#endif
+}
+
+/**
+ * Stop the run if it is over its instruction budget or deadline. Called by
+ * the execution loops on backward jumps.
+ */
+void governor_check() {
+    if (limits.max_insns > 0 && governor_insns > limits.max_insns) {
+        governor_exceeded(LIMIT_INSNS, "instruction", limits.max_insns);
+    }
+    if (deadline_passed) {
+        governor_exceeded(LIMIT_TIME, "time (ms)", limits.timeout_ms);
+    }
+}
+
+/**
+ * Backward jump inside a loop compiled by the JIT, which counts `insns`
+ * instructions per iteration
+ */
+void governor_jit_edge(uint64_t insns) {
+    governor_insns += insns;
+    governor_check();
+}
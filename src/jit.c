@@ -0,0 +1,336 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the template JIT used by the threaded engine with --jit.
+ * Backward goto()s are counted, and once a loop gets hot, the instructions
+ * from the goto() target up to the goto() itself are translated into x86-64
+ * code in an executable mapping. Each instruction becomes a direct call to
+ * its handler or to libc, jumps inside the loop become native jumps, and
+ * leaving the loop returns the index of the next instruction to the
+ * interpreter.
+ *
+ * Register usage follows the System V AMD64 ABI. The generated function keeps
+ * one stack slot at [rsp] for the stack_node_t * handed to handlers.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <engine.h>
+#include <jit.h>
+#include <governor.h>
+
+#ifdef JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+bool jit_enabled;
+
+// A compiled loop
+struct jit_region {
+    int32_t start; // First instruction
+    int32_t end; // The backward goto()
+    int32_t first_line;
+    int32_t last_line;
+    size_t code_size;
+    uint64_t entries;
+    insn_t *entry;
+    struct jit_region *next;
+};
+typedef struct jit_region jit_region_t;
+
+static jit_region_t *regions;
+
+static void jit_print_stats() {
+    jit_region_t *cur;
+    int32_t count = 0;
+
+#ifndef JIT_SUPPORTED
+    fputs("[jit] not supported on this platform, the interpreter was used\n",
+          stderr);
+    return;
+#endif
+
+    for (cur = regions; cur != NULL; cur = cur->next) count++;
+    fprintf(stderr, "\n[jit] %d region(s) compiled\n", count);
+    for (cur = regions; cur != NULL; cur = cur->next) {
+        fprintf(stderr, "[jit] lines %d-%d: %d instructions, %zu bytes, "
+                "entered %llu time(s)\n", cur->first_line, cur->last_line,
+                cur->end - cur->start + 1, cur->code_size,
+                (unsigned long long) cur->entries);
+    }
+}
+
+/**
+ * Enable the JIT. A report of compiled regions is printed at exit.
+ */
+void jit_init() {
+#ifdef JIT_SUPPORTED
+    jit_enabled = true;
+#endif
+    regions = NULL;
+    atexit(jit_print_stats);
+}
+
+#ifdef JIT_SUPPORTED
+
+// Growable buffer that machine code is assembled into
+struct jit_buf {
+    uint8_t *code;
+    size_t len;
+    size_t cap;
+
+    // Pending rel32 operands, resolved once all labels are known
+    int32_t *fixup_offs;
+    int32_t *fixup_pcs; // -1 for the epilogue
+    int32_t num_fixups;
+    int32_t max_fixups;
+};
+typedef struct jit_buf jit_buf_t;
+
+static void emit8(jit_buf_t *buf, uint8_t b) {
+    if (buf->len == buf->cap) {
+        buf->cap *= 2;
+        buf->code = realloc(buf->code, buf->cap);
+    }
+    buf->code[buf->len++] = b;
+}
+
+static void emit_bytes(jit_buf_t *buf, char *bytes, int32_t n) {
+    int32_t i;
+    for (i=0; i<n; i++) emit8(buf, (uint8_t) bytes[i]);
+}
+
+static void emit32(jit_buf_t *buf, uint32_t v) {
+    int32_t i;
+    for (i=0; i<4; i++) emit8(buf, (v >> (i*8)) & 0xff);
+}
+
+static void emit64(jit_buf_t *buf, uint64_t v) {
+    int32_t i;
+    for (i=0; i<8; i++) emit8(buf, (v >> (i*8)) & 0xff);
+}
+
+// rel32 operand referring to the instruction at `pc`, or the epilogue
+static void emit_rel32(jit_buf_t *buf, int32_t pc) {
+    if (buf->num_fixups == buf->max_fixups) {
+        buf->max_fixups *= 2;
+        buf->fixup_offs = realloc(buf->fixup_offs,
+                                  sizeof(int32_t) * buf->max_fixups);
+        buf->fixup_pcs = realloc(buf->fixup_pcs,
+                                 sizeof(int32_t) * buf->max_fixups);
+    }
+    buf->fixup_offs[buf->num_fixups] = buf->len;
+    buf->fixup_pcs[buf->num_fixups] = pc;
+    buf->num_fixups++;
+    emit32(buf, 0);
+}
+
+// mov rdi, imm64
+static void emit_arg0(jit_buf_t *buf, void *v) {
+    emit_bytes(buf, "\x48\xbf", 2);
+    emit64(buf, (uint64_t) (uintptr_t) v);
+}
+
+// mov rax, imm64; call rax
+static void emit_call(jit_buf_t *buf, void *fn) {
+    emit_bytes(buf, "\x48\xb8", 2);
+    emit64(buf, (uint64_t) (uintptr_t) fn);
+    emit_bytes(buf, "\xff\xd0", 2);
+}
+
+// fputs(str, stdout)
+static void emit_fputs(jit_buf_t *buf, char *str) {
+    emit_arg0(buf, str);
+    emit_bytes(buf, "\x48\xb8", 2); // mov rax, &stdout
+    emit64(buf, (uint64_t) (uintptr_t) &stdout);
+    emit_bytes(buf, "\x48\x8b\x30", 3); // mov rsi, [rax]
+    emit_call(buf, (void *) fputs);
+}
+
+// putchar('\n')
+static void emit_newline(jit_buf_t *buf) {
+    emit8(buf, 0xbf); // mov edi, imm32
+    emit32(buf, '\n');
+    emit_call(buf, (void *) putchar);
+}
+
+// handle_cmd(&node), with node stored in the stack slot
+static void emit_handler(jit_buf_t *buf, insn_t *insn) {
+    emit_bytes(buf, "\x48\xb8", 2); // mov rax, node
+    emit64(buf, (uint64_t) (uintptr_t) insn->node);
+    emit_bytes(buf, "\x48\x89\x04\x24", 4); // mov [rsp], rax
+    emit_bytes(buf, "\x48\x89\xe7", 3); // mov rdi, rsp
+    emit_call(buf, (void *) insn->handle_cmd);
+}
+
+// Continue at `pc`, leaving the native code if it is outside the region
+static void emit_jump(jit_buf_t *buf, jit_region_t *region, int32_t pc) {
+    if (pc < region->start || pc > region->end) {
+        emit8(buf, 0xb8); // mov eax, pc
+        emit32(buf, pc);
+        pc = -1;
+    }
+    emit8(buf, 0xe9); // jmp rel32
+    emit_rel32(buf, pc);
+}
+
+// Continue at `pc` if al is zero
+static void emit_jump_if_false(jit_buf_t *buf, jit_region_t *region,
+                               int32_t pc) {
+    emit_bytes(buf, "\x84\xc0", 2); // test al, al
+    if (pc < region->start || pc > region->end) {
+        emit_bytes(buf, "\x75\x0a", 2); // jnz over the exit below
+        emit_jump(buf, region, pc);
+    } else {
+        emit_bytes(buf, "\x0f\x84", 2); // jz rel32
+        emit_rel32(buf, pc);
+    }
+}
+
+static void emit_insn(jit_buf_t *buf, jit_region_t *region, insn_t *insn,
+                      int32_t pc) {
+    switch (insn->op) {
+    case OP_SAY:
+        emit_fputs(buf, insn->node->parameters[0]);
+        break;
+    case OP_SAYLN:
+        emit_fputs(buf, insn->node->parameters[0]);
+        emit_newline(buf);
+        break;
+    case OP_SAY_SAYLN:
+        emit_fputs(buf, insn->node->parameters[0]);
+        emit_fputs(buf, insn[1].node->parameters[0]);
+        emit_newline(buf);
+        emit_jump(buf, region, pc + 2);
+        break;
+    case OP_DEFINE:
+    case OP_DEFINE_GOTO:
+        emit_handler(buf, insn);
+        break;
+    case OP_GOTO:
+        if (governor_active && insn->target <= pc) {
+            // governor_jit_edge(instructions per iteration)
+            emit_arg0(buf, (void *) (uintptr_t) (pc - insn->target + 1));
+            emit_call(buf, (void *) governor_jit_edge);
+        }
+        emit_jump(buf, region, insn->target);
+        break;
+    case OP_IF:
+        emit_arg0(buf, insn->node);
+        emit_call(buf, (void *) engine_eval_if);
+        emit_jump_if_false(buf, region, insn->target);
+        break;
+    default:
+        // Generic call, which returns the next instruction in eax
+        emit_arg0(buf, insn);
+        emit_call(buf, (void *) engine_call);
+        emit8(buf, 0x3d); // cmp eax, pc + 1
+        emit32(buf, pc + 1);
+        emit_bytes(buf, "\x0f\x85", 2); // jne epilogue
+        emit_rel32(buf, -1);
+        break;
+    }
+}
+
+/**
+ * Compile the loop closed by the backward goto() at `ip`
+ */
+static void jit_compile_region(program_t *prog, insn_t *ip) {
+    jit_region_t *region = malloc(sizeof(jit_region_t));
+    region->start = ip->target;
+    region->end = ip - prog->code;
+    region->first_line = prog->code[region->start].node->linenum;
+    region->last_line = ip->node->linenum;
+    region->entries = 0;
+    region->entry = ip;
+
+    jit_buf_t buf;
+    buf.cap = 256;
+    buf.len = 0;
+    buf.code = malloc(buf.cap);
+    buf.max_fixups = 16;
+    buf.num_fixups = 0;
+    buf.fixup_offs = malloc(sizeof(int32_t) * buf.max_fixups);
+    buf.fixup_pcs = malloc(sizeof(int32_t) * buf.max_fixups);
+
+    int32_t num_insns = region->end - region->start + 1;
+    int32_t label_offs[num_insns];
+
+    emit_bytes(&buf, "\x48\x83\xec\x18", 4); // sub rsp, 24
+    int32_t pc;
+    for (pc = region->start; pc <= region->end; pc++) {
+        label_offs[pc - region->start] = buf.len;
+        emit_insn(&buf, region, &prog->code[pc], pc);
+    }
+    emit_jump(&buf, region, region->end + 1);
+
+    int32_t epilogue = buf.len;
+    emit_bytes(&buf, "\x48\x83\xc4\x18", 4); // add rsp, 24
+    emit8(&buf, 0xc3); // ret
+
+    // Resolve jumps
+    int32_t i;
+    for (i=0; i<buf.num_fixups; i++) {
+        int32_t target = buf.fixup_pcs[i] == -1 ? epilogue :
+                         label_offs[buf.fixup_pcs[i] - region->start];
+        int32_t rel = target - (buf.fixup_offs[i] + 4);
+        memcpy(buf.code + buf.fixup_offs[i], &rel, 4);
+    }
+
+    // Copy into an executable mapping
+    void *mem = mmap(NULL, buf.len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem != MAP_FAILED) {
+        memcpy(mem, buf.code, buf.len);
+        if (mprotect(mem, buf.len, PROT_READ | PROT_EXEC) == 0) {
+            ip->native = (int32_t (*)(void)) mem;
+            region->code_size = buf.len;
+            region->next = regions;
+            regions = region;
+        } else {
+            munmap(mem, buf.len);
+        }
+    }
+
+    free(buf.code);
+    free(buf.fixup_offs);
+    free(buf.fixup_pcs);
+    if (ip->native == NULL) free(region);
+}
+
+#else
+
+static void jit_compile_region(program_t *prog, insn_t *ip) {
+}
+
+#endif
+
+/**
+ * Called by the engine when the goto() at `ip` jumps backward. Runs the loop
+ * natively once it is hot.
+ * @return index of the instruction to continue interpreting at
+ */
+int32_t jit_backward_edge(program_t *prog, insn_t *ip) {
+    if (ip->native == NULL) {
+        if (++ip->hotness != JIT_HOT_THRESHOLD) return ip->target;
+
+        jit_compile_region(prog, ip);
+        if (ip->native == NULL) return ip->target;
+    }
+
+    jit_region_t *cur;
+    for (cur = regions; cur != NULL; cur = cur->next) {
+        if (cur->entry == ip) cur->entries++;
+    }
+    return ip->native();
+}
@@ -0,0 +1,219 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the command line lexer. A line is scanned exactly once
+ * to find the command name and the spans of its arguments. An argument may
+ * be wrapped in double quotes, in which commas and parenthesis lose their
+ * meaning and backslash escapes such as \" and \n are resolved. Quotes
+ * anywhere else are text, and outside of quotes a backslash only escapes
+ * the characters the lexer gives a meaning to, and not the parenthesis that
+ * ends the line. Text written for older versions, like shell commands and
+ * Windows paths, reads the same.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <lexer.h>
+#include <cmd.h>
+
+static bool is_name_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Whether a backslash before `c` escapes it outside of quotes
+static bool is_syntax_char(char c) {
+    return c == ',' || c == '(' || c == ')' || c == '"';
+}
+
+/**
+ * Whether the backslash at `pos`, outside of quotes, escapes the character
+ * after it. A backslash before the parenthesis that ends the line is text,
+ * so that an argument such as C:\ can end a command.
+ */
+static bool is_escape(char *input, int32_t pos, int32_t input_len) {
+    if (pos + 1 >= input_len || !is_syntax_char(input[pos+1])) return false;
+    if (input[pos+1] != ')') return true;
+
+    int32_t i;
+    for (i = pos + 2; i < input_len && input[i] != '\0'; i++) {
+        if (!is_blank(input[i])) return true;
+    }
+    return false;
+}
+
+/**
+ * Lex a command line of the form [BasilC-]name(arg, arg, ...)
+ * Blank lines produce an empty name span.
+ * @return ERR_SUCCESS, or a parse_error with parse_error_col set
+ */
+int32_t lex_command(char *input, int32_t input_len, lexed_cmd_t *out) {
+    int32_t pos = 0;
+    memset(out, 0, sizeof(lexed_cmd_t));
+
+    // Skip indentation
+    while (pos < input_len && is_blank(input[pos])) pos++;
+    if (pos == input_len || input[pos] == '\0') return ERR_SUCCESS;
+
+    // Skip optional BasilC- prefix
+    if (input_len - pos > 7 && strncmp(input+pos, "BasilC-", 7) == 0) {
+        pos += 7;
+    }
+
+    // Command name
+    out->name.start = pos;
+    while (pos < input_len && is_name_char(input[pos])) pos++;
+    out->name.len = pos - out->name.start;
+    if (pos == input_len || input[pos] != '(') {
+        parse_error_col = pos + 1;
+        return ERR_PAREN;
+    }
+    if (out->name.len == 0) {
+        parse_error_col = pos + 1;
+        return ERR_INVALID_CMD;
+    }
+    int32_t open_paren = pos++;
+
+    // Arguments, up to the matching close parenthesis
+    out->body.start = pos;
+    int32_t arg_start = pos;
+    int32_t quote_start = -1;
+    int32_t depth = 0;
+    bool closed = false;
+    bool arg_blank = true; // Whether the argument is blank so far
+    for (; pos < input_len && input[pos] != '\0'; pos++) {
+        char c = input[pos];
+        bool was_blank = arg_blank;
+        if (!is_blank(c)) arg_blank = false;
+        if (c == '\\' && quote_start >= 0) {
+            if (pos + 1 >= input_len || input[pos+1] == '\0') {
+                parse_error_col = pos + 1;
+                return ERR_ESCAPE;
+            }
+            pos++;
+        } else if (c == '\\') {
+            // Outside of quotes only syntax characters are escaped
+            if (is_escape(input, pos, input_len)) pos++;
+        } else if (quote_start >= 0) {
+            if (c == '"') quote_start = -1;
+        } else if (c == '"' && was_blank) {
+            // Quotes only mean something at the start of an argument
+            quote_start = pos;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')' && depth > 0) {
+            depth--;
+        } else if ((c == ',' && depth == 0) || c == ')') {
+            if (out->num_args < STACK_PARAMETER_MAX_AMOUNT) {
+                out->args[out->num_args].start = arg_start;
+                out->args[out->num_args].len = pos - arg_start;
+            }
+            out->num_args++;
+            arg_start = pos + 1;
+            arg_blank = true;
+            if (c == ')') {
+                closed = true;
+                break;
+            }
+        }
+    }
+
+    if (quote_start >= 0) {
+        parse_error_col = quote_start + 1;
+        return ERR_QUOTE;
+    }
+    if (!closed) {
+        parse_error_col = open_paren + 1;
+        return ERR_PAREN;
+    }
+    out->body.len = pos - out->body.start;
+
+    // An empty body means no arguments rather than one empty argument
+    if (out->body.len == 0) out->num_args = 0;
+
+    // Nothing but whitespace may follow the command
+    for (pos++; pos < input_len && input[pos] != '\0'; pos++) {
+        if (!is_blank(input[pos])) {
+            parse_error_col = pos + 1;
+            return ERR_TRAILING;
+        }
+    }
+
+    return ERR_SUCCESS;
+}
+
+/**
+ * Find the quote that closes one at `start`, if the argument from `start` to
+ * `end` is wrapped in quotes
+ * @return the index of the closing quote, or -1
+ */
+static int32_t wrapping_quote(char *input, int32_t start, int32_t end) {
+    if (start >= end || input[start] != '"') return -1;
+
+    int32_t pos;
+    for (pos = start + 1; pos < end && input[pos] != '"'; pos++) {
+        if (input[pos] == '\\') pos++;
+    }
+    if (pos >= end) return -1;
+
+    // Only blanks may follow
+    int32_t close = pos;
+    for (pos++; pos < end; pos++) {
+        if (!is_blank(input[pos])) return -1;
+    }
+    return close;
+}
+
+/**
+ * Copy an argument span into `buf`. Quotes around the whole argument are
+ * removed and the escapes inside them resolved, while other arguments are
+ * copied as they are, except for escaped syntax characters.
+ * If `trim` is set, leading whitespace is skipped.
+ * @return ERR_SUCCESS, or ERR_ARG_LENGTH if the argument doesn't fit
+ */
+int32_t lex_decode_arg(char *buf, int32_t buf_len, char *input,
+                       lex_span_t span, bool trim) {
+    int32_t end = span.start + span.len;
+    int32_t pos = span.start;
+    int32_t len = 0;
+
+    if (trim) {
+        while (pos < end && is_blank(input[pos])) pos++;
+    }
+
+    int32_t first = pos;
+    while (first < end && is_blank(input[first])) first++;
+    int32_t close = wrapping_quote(input, first, end);
+    bool quoted = close > -1;
+    if (quoted) {
+        pos = first + 1;
+        end = close;
+    }
+
+    for (; pos < end; pos++) {
+        char c = input[pos];
+        if (c == '\\' && pos + 1 < end &&
+            (quoted || is_syntax_char(input[pos+1]))) {
+            c = input[++pos];
+            if (quoted && c == 'n') c = '\n';
+            else if (quoted && c == 't') c = '\t';
+        }
+        if (len >= buf_len - 1) {
+            parse_error_col = pos + 1;
+            return ERR_ARG_LENGTH;
+        }
+        buf[len++] = c;
+    }
+    buf[len] = '\0';
+
+    return ERR_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains code that defines BasilC commands for maps and arrays,
+ * such as put(), get(), push() and each()
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <collection.h>
+#include <memstat.h>
+
+/**
+ * Replace the variables in a parameter
+ * @return the text to use. *parsed is set to a string that has to be freed
+ *         with basilc_free(), or NULL.
+ */
+static char * interpolate(char *param, char **parsed) {
+    *parsed = parse_var_string(param);
+    return *parsed != NULL ? *parsed : param;
+}
+
+// Handle execution of BasilC-put()
+bool basilc_put_callback(stack_node_t **node) {
+    char *name = (*node)->parameters[0];
+    collection_t *coll = collection_of_var(name, COLL_ANY, false);
+    if (coll == NULL) coll = collection_of_var(name, COLL_MAP, true);
+
+    char *parsed_key, *parsed_val;
+    char *key = interpolate((*node)->parameters[1], &parsed_key);
+    char *val = interpolate((*node)->parameters[2], &parsed_val);
+
+    value_t *value = collection_put(coll, key);
+    if (value != NULL) {
+        value_set(value, val, strlen(val));
+    } else {
+        printf("Index %s is out of range for %s!\n", key, name);
+    }
+
+    if (parsed_key != NULL) basilc_free(parsed_key);
+    if (parsed_val != NULL) basilc_free(parsed_val);
+    return value != NULL;
+}
+
+// Handle execution of BasilC-get()
+bool basilc_get_callback(stack_node_t **node) {
+    collection_t *coll = collection_of_var((*node)->parameters[0], COLL_ANY,
+                                           false);
+    char *parsed;
+    char *key = interpolate((*node)->parameters[1], &parsed);
+
+    // Missing elements read as empty strings
+    value_t *value = coll != NULL ? collection_get(coll, key) : NULL;
+    define_var((*node)->parameters[2],
+               value != NULL ? value_flatten(value) : "");
+
+    if (parsed != NULL) basilc_free(parsed);
+    return true;
+}
+
+// Handle execution of BasilC-del()
+bool basilc_del_callback(stack_node_t **node) {
+    collection_t *coll = collection_of_var((*node)->parameters[0], COLL_ANY,
+                                           false);
+    if (coll == NULL) return true;
+
+    char *parsed;
+    char *key = interpolate((*node)->parameters[1], &parsed);
+    collection_del(coll, key);
+    if (parsed != NULL) basilc_free(parsed);
+    return true;
+}
+
+// Handle execution of BasilC-len()
+bool basilc_len_callback(stack_node_t **node) {
+    variable_stack_node_t *var = var_stack_search_label((*node)->parameters[0]);
+    size_t len = 0;
+    if (var != NULL) {
+        len = var->coll != NULL ? (size_t) var->coll->len : var->value.len;
+    }
+
+    char buf[24];
+    sprintf(buf, "%zu", len);
+    define_var((*node)->parameters[1], buf);
+    return true;
+}
+
+// Handle execution of BasilC-push()
+bool basilc_push_callback(stack_node_t **node) {
+    collection_t *coll = collection_of_var((*node)->parameters[0], COLL_ANY,
+                                           false);
+    if (coll == NULL) {
+        coll = collection_of_var((*node)->parameters[0], COLL_ARRAY, true);
+    } else if (coll->kind != COLL_ARRAY) {
+        printf("Variable %s is not an array!\n", (*node)->parameters[0]);
+        return false;
+    }
+
+    char *parsed;
+    char *val = interpolate((*node)->parameters[1], &parsed);
+    value_set(collection_push(coll), val, strlen(val));
+    if (parsed != NULL) basilc_free(parsed);
+    return true;
+}
+
+// Handle execution of BasilC-each()
+bool basilc_each_callback(stack_node_t **node) {
+    each_state_t *state = collection_each_state(*node);
+    bool first = !state->resume;
+    state->resume = false;
+
+    // Leave the loop once every element was visited
+    if (!collection_each(*node, first)) {
+        *node = (*node)->block->next;
+    }
+    return true;
+}
+// Handle special parsing of BasilC-each()
+bool basilc_each_special_parse() {
+    // The loop variable is reassigned on every iteration, so it can't be the
+    // collection itself
+    if (strcmp(current_stack->parameters[0],
+               current_stack->parameters[1]) == 0) {
+        return false;
+    }
+    // Tasks would share the loop state kept in the node
+    if (block_inside("parallel") || block_inside("pareach")) return false;
+    return block_open(current_stack);
+}
+
+// Handle execution of BasilC-endeach()
+bool basilc_endeach_callback(stack_node_t **node) {
+    // Continue with the next element
+    collection_each_state((*node)->block)->resume = true;
+    *node = (*node)->block;
+    return true;
+}
+// Handle special parsing of BasilC-endeach()
+bool basilc_endeach_special_parse() {
+    return block_close(current_stack, "each") != NULL;
+}
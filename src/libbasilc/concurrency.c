@@ -0,0 +1,152 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains code that defines BasilC commands that run parts of a
+ * script at the same time, parallel() and pareach(). See parallel.c for the
+ * thread pool they run on.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <parallel.h>
+#include <collection.h>
+#include <memstat.h>
+
+// Tasks of a parallel() block, kept in its data field
+struct task_list {
+    task_t *tasks;
+    int32_t num_tasks;
+};
+typedef struct task_list task_list_t;
+
+// Guards splitting, since a parallel() nested in pareach() runs on many
+// threads at once
+static pthread_mutex_t split_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void add_task(task_list_t *list, stack_node_t *start,
+                     stack_node_t *end) {
+    if (start == end) return;
+
+    list->tasks = basilc_realloc(list->tasks, sizeof(task_t) *
+                                 (list->num_tasks + 1), MEM_CODE);
+    task_t *task = &list->tasks[list->num_tasks++];
+    memset(task, 0, sizeof(task_t));
+    task->start = start;
+    task->end = end;
+}
+
+/**
+ * Split a parallel() block into one task per label(). Commands before the
+ * first label() are a task of their own.
+ */
+static task_list_t * split_tasks(stack_node_t *node) {
+    task_list_t *list = basilc_malloc(sizeof(task_list_t), MEM_CODE);
+    list->tasks = NULL;
+    list->num_tasks = 0;
+
+    stack_node_t *start = node->next;
+    stack_node_t *cur;
+    for (cur = node->next; cur != node->block; cur = cur->next) {
+        if (strcmp(cur->command, "label") == 0) {
+            add_task(list, start, cur);
+            start = cur;
+        } else if (strcmp(cur->command, "parallel") == 0 ||
+                   strcmp(cur->command, "pareach") == 0) {
+            // Labels of nested blocks belong to them
+            cur = cur->block;
+        }
+    }
+    add_task(list, start, node->block);
+    return list;
+}
+
+// Handle execution of BasilC-parallel()
+bool basilc_parallel_callback(stack_node_t **node) {
+    pthread_mutex_lock(&split_lock);
+    if ((*node)->data == NULL) (*node)->data = split_tasks(*node);
+    task_list_t *list = (*node)->data;
+    pthread_mutex_unlock(&split_lock);
+
+    parallel_run(list->tasks, list->num_tasks);
+    *node = (*node)->block->next;
+    return true;
+}
+// Handle special parsing of BasilC-parallel()
+bool basilc_parallel_special_parse() {
+    return block_open(current_stack);
+}
+
+// Handle special parsing of BasilC-endparallel()
+bool basilc_endparallel_special_parse() {
+    return block_close(current_stack, "parallel") != NULL;
+}
+
+// Handle execution of BasilC-pareach()
+bool basilc_pareach_callback(stack_node_t **node) {
+    char *name = (*node)->parameters[0];
+
+    // Copy the elements first, since tasks may change the collection
+    task_lock_var(name);
+    collection_t *coll = collection_of_var(name, COLL_ANY, false);
+    int32_t num_tasks = 0;
+    task_t *tasks = NULL;
+    if (coll != NULL && coll->len > 0) {
+        tasks = basilc_malloc(sizeof(task_t) * coll->len, MEM_VARS);
+        int32_t i;
+        for (i=0; i<coll->num_entries; i++) {
+            coll_entry_t *entry = &coll->entries[i];
+            char *elem;
+            if (coll->kind == COLL_ARRAY) {
+                elem = value_flatten(&entry->value);
+            } else if (entry->key != NULL) {
+                elem = entry->key;
+            } else {
+                continue;
+            }
+
+            task_t *task = &tasks[num_tasks++];
+            memset(task, 0, sizeof(task_t));
+            task->start = (*node)->next;
+            task->end = (*node)->block;
+            task->var_name = (*node)->parameters[1];
+            task->var_value = basilc_malloc(strlen(elem) + 1, MEM_VARS);
+            strcpy(task->var_value, elem);
+        }
+    }
+    task_unlock_var(name);
+
+    if (num_tasks > 0) {
+        parallel_run(tasks, num_tasks);
+
+        int32_t i;
+        for (i=0; i<num_tasks; i++) basilc_free(tasks[i].var_value);
+        basilc_free(tasks);
+    }
+    *node = (*node)->block->next;
+    return true;
+}
+// Handle special parsing of BasilC-pareach()
+bool basilc_pareach_special_parse() {
+    // Every task gets its own copy of the loop variable, which would hide
+    // the collection
+    if (strcmp(current_stack->parameters[0],
+               current_stack->parameters[1]) == 0) {
+        return false;
+    }
+    return block_open(current_stack);
+}
+
+// Handle special parsing of BasilC-endpareach()
+bool basilc_endpareach_special_parse() {
+    return block_close(current_stack, "pareach") != NULL;
+}
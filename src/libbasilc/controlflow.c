@@ -5,34 +5,36 @@
  */
 /**
  * This file contains code that defines BasilC commands related to program
- * control flow, such as if(), endif(), label(), goto(), and end()
+ * control flow, such as if(), endif(), while(), label(), goto(), call() and
+ * end()
  */
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <main.h>
 #include <cmd.h>
+#include <memstat.h>
+#include <callstack.h>
+#include <expr.h>
 
 // Handle execution of BasilC-if()
 bool basilc_if_callback(stack_node_t **node) {
-    bool cond;
-
-    // Try to parse variables in string
-    char *parsed = parse_var_string((*node)->parameters[0]);
-    if (parsed != NULL) {
-        // If variables were parsed correctly
-        cond = eval_conditional(parsed);
-        free(parsed);
-    } else {
-        cond = eval_conditional((*node)->parameters[0]);
-    }
-
     // If condition is true, mark all commands in block as execute
-    if (cond) {
+    if (eval_node_conditional(*node)) {
         set_block_execute(*node, true);
+        return true;
     }
+
+    // Otherwise jump to the endif(), like the engine does. The marks of an
+    // earlier pass through a loop must not run the block again.
+    stack_node_t *cur = (*node)->next;
+    while (cur->command != NULL && strcmp(cur->command, "endif") != 0)
+        cur = cur->next;
+    *node = cur;
     return true;
 }
 // Handle special parsing of BasilC-if()
@@ -40,7 +42,7 @@ bool basilc_if_special_parse() {
     // BasilC-if() requires in_block to be set to true
     // at time of parsing
     in_block = true;
-    return true;
+    return expr_parse_node(0);
 }
 
 // Handle special parsing of BasilC-endif()
@@ -53,6 +55,88 @@ bool basilc_endif_special_parse() {
     }
 }
 
+// Handle execution of BasilC-while()
+bool basilc_while_callback(stack_node_t **node) {
+    // Leave the loop once the condition is false
+    if (!eval_node_conditional(*node)) {
+        *node = (*node)->block->next;
+    }
+    return true;
+}
+// Handle special parsing of BasilC-while()
+bool basilc_while_special_parse() {
+    return block_open(current_stack) && expr_parse_node(0);
+}
+
+// Handle execution of BasilC-endwhile()
+bool basilc_endwhile_callback(stack_node_t **node) {
+    // Test the condition again
+    *node = (*node)->block;
+    return true;
+}
+// Handle special parsing of BasilC-endwhile()
+bool basilc_endwhile_special_parse() {
+    stack_node_t *start = block_close(current_stack, "while");
+    if (start == NULL) return false;
+
+    // An if() block has to be either inside the loop or around all of it
+    bool open_if = false;
+    stack_node_t *cur;
+    for (cur = start->next; cur != current_stack; cur = cur->next) {
+        if (strcmp(cur->command, "if") == 0) {
+            open_if = true;
+        } else if (strcmp(cur->command, "endif") == 0) {
+            if (!open_if) break;
+            open_if = false;
+        }
+    }
+    if (cur != current_stack || open_if) {
+        printf("endwhile() can't close the while() block at line %d "
+               "across an if() block!\n", start->linenum);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Link a break() or continue() to the innermost while() around it
+ * @return false if there is none, or if a parallel task is in between
+ */
+static bool link_loop() {
+    int32_t depth = block_depth("while");
+    if (depth == 0) {
+        printf("%s() outside of a while() block!\n", current_stack->command);
+        return false;
+    }
+    // Leaving a parallel task ends it, so the loop could never continue
+    if (block_depth("parallel") > depth || block_depth("pareach") > depth) {
+        return false;
+    }
+    current_stack->block = block_at(depth);
+    return true;
+}
+
+// Handle execution of BasilC-break()
+bool basilc_break_callback(stack_node_t **node) {
+    // Continue after the endwhile()
+    *node = (*node)->block->block->next;
+    return true;
+}
+// Handle special parsing of BasilC-break()
+bool basilc_break_special_parse() {
+    return link_loop();
+}
+
+// Handle execution of BasilC-continue()
+bool basilc_continue_callback(stack_node_t **node) {
+    *node = (*node)->block;
+    return true;
+}
+// Handle special parsing of BasilC-continue()
+bool basilc_continue_special_parse() {
+    return link_loop();
+}
+
 // Handle execution of BasilC-goto()
 bool basilc_goto_callback(stack_node_t **node) {
     stack_node_t *label = stack_search_label((*node)->parameters[0]);
@@ -64,6 +148,42 @@ bool basilc_goto_callback(stack_node_t **node) {
     }
 }
 
+// Handle execution of BasilC-call()
+bool basilc_call_callback(stack_node_t **node) {
+    // The label was found by parse_cleanup()
+    if (!call_push((*node)->next)) {
+        printf("Too many nested calls!\n");
+        return false;
+    }
+    *node = (*node)->block;
+    return true;
+}
+// Handle special parsing of BasilC-call()
+bool basilc_call_special_parse() {
+    // Leaving a parallel task ends it, so the call could never return
+    return !block_inside("parallel") && !block_inside("pareach");
+}
+
+// Handle execution of BasilC-return()
+bool basilc_return_callback(stack_node_t **node) {
+    stack_node_t *ret = call_pop();
+    if (ret == NULL) {
+        printf("return() outside of a call!\n");
+        return false;
+    }
+    *node = ret;
+    return true;
+}
+
+// Handle execution of BasilC-local()
+bool basilc_local_callback(stack_node_t **node) {
+    if (!call_local((*node)->parameters[0])) {
+        printf("local() outside of a call!\n");
+        return false;
+    }
+    return true;
+}
+
 // Handle execution of BasilC-end()
 bool basilc_end_callback(stack_node_t **node) {
     // Exit program
@@ -0,0 +1,286 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains code that defines BasilC commands for reading and
+ * writing files, such as open(), readline(), csv() and write(). Files are
+ * referred to by handle names, which are separate from variable names.
+ *
+ * Files opened for reading are split into lines by a line_reader_t. csv()
+ * splits those lines into fields at the commas and quotes that
+ * text_index() finds, copying each field straight into an array element. Files
+ * opened for writing get a WRITER_BUFFER_SIZE buffer, and all files that
+ * are still open are flushed and closed at exit.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <linereader.h>
+#include <collection.h>
+#include <textscan.h>
+#include <memstat.h>
+
+// Max number of files open at once
+#define MAX_OPEN_FILES 64
+
+// Size of the buffer of files opened for writing
+#define WRITER_BUFFER_SIZE 65536
+
+// Number of characters of a line csv() indexes at once
+#define CSV_WINDOW 4096
+
+struct file_handle {
+    char name[MAX_DATA_SIZE];
+    FILE *fp;
+    line_reader_t *reader; // NULL if the file is open for writing
+};
+typedef struct file_handle file_handle_t;
+
+static file_handle_t files[MAX_OPEN_FILES];
+
+static file_handle_t * find_file(char *name) {
+    int32_t i;
+    for (i=0; i<MAX_OPEN_FILES; i++) {
+        if (files[i].fp != NULL && strcmp(files[i].name, name) == 0) {
+            return &files[i];
+        }
+    }
+    return NULL;
+}
+
+static void close_file(file_handle_t *file) {
+    if (file->reader != NULL) reader_free(file->reader);
+    fclose(file->fp);
+    file->fp = NULL;
+    file->reader = NULL;
+}
+
+// Flush and close every open file, called at exit
+static void close_all_files() {
+    int32_t i;
+    for (i=0; i<MAX_OPEN_FILES; i++) {
+        if (files[i].fp != NULL) close_file(&files[i]);
+    }
+}
+
+/**
+ * Find an open file for a command, printing an error if there is none
+ * @param reading whether the file has to be open for reading or writing
+ */
+static file_handle_t * get_file(char *name, bool reading) {
+    file_handle_t *file = find_file(name);
+    if (file == NULL) {
+        printf("File handle %s is not open!\n", name);
+    } else if ((file->reader != NULL) != reading) {
+        printf("File handle %s is not open for %s!\n", name,
+               reading ? "reading" : "writing");
+        return NULL;
+    }
+    return file;
+}
+
+// Handle execution of BasilC-open()
+bool basilc_open_callback(stack_node_t **node) {
+    static bool registered;
+    char *mode = (*node)->parameters[1];
+    char *name = (*node)->parameters[2];
+
+    if (strcmp(mode, "r") != 0 && strcmp(mode, "w") != 0 &&
+        strcmp(mode, "a") != 0) {
+        printf("Invalid file mode %s, expected r, w or a!\n", mode);
+        return false;
+    }
+
+    // Reopening a handle closes the old file
+    file_handle_t *file = find_file(name);
+    if (file != NULL) close_file(file);
+
+    int32_t i;
+    for (i=0; i<MAX_OPEN_FILES && files[i].fp != NULL; i++);
+    if (i == MAX_OPEN_FILES) {
+        printf("Too many open files!\n");
+        return false;
+    }
+    file = &files[i];
+
+    char *parsed = parse_var_string((*node)->parameters[0]);
+    char *path = parsed != NULL ? parsed : (*node)->parameters[0];
+    file->fp = fopen(path, mode);
+    if (file->fp == NULL) {
+        printf("Can't open %s: %s\n", path, strerror(errno));
+        if (parsed != NULL) basilc_free(parsed);
+        return false;
+    }
+    if (parsed != NULL) basilc_free(parsed);
+
+    strncpy(file->name, name, MAX_DATA_SIZE-1);
+    file->name[MAX_DATA_SIZE-1] = '\0';
+    if (mode[0] == 'r') {
+        file->reader = reader_create(file->fp);
+    } else {
+        setvbuf(file->fp, NULL, _IOFBF, WRITER_BUFFER_SIZE);
+    }
+
+    if (!registered) {
+        atexit(close_all_files);
+        registered = true;
+    }
+    return true;
+}
+
+// Handle execution of BasilC-readline()
+bool basilc_readline_callback(stack_node_t **node) {
+    file_handle_t *file = get_file((*node)->parameters[0], true);
+    if (file == NULL) return false;
+
+    // Reading past the end gives an empty line, see eof()
+    size_t len;
+    char *line = reader_next_line(file->reader, &len);
+    define_var((*node)->parameters[1], line != NULL ? line : "");
+    return true;
+}
+
+// Handle execution of BasilC-eof()
+bool basilc_eof_callback(stack_node_t **node) {
+    file_handle_t *file = get_file((*node)->parameters[0], true);
+    if (file == NULL) return false;
+
+    define_var((*node)->parameters[1], reader_at_end(file->reader) ? "1" : "0");
+    return true;
+}
+
+// A record being read by csv()
+struct csv_record {
+    collection_t *fields;
+    int32_t num_fields; // Including the current one
+    bool started; // Whether the current field has text yet
+    bool quoted; // Whether the current field is inside quotes
+};
+typedef struct csv_record csv_record_t;
+
+// Add text to the current field, reusing the buffer of its element
+static void csv_add(csv_record_t *rec, char *text, size_t len) {
+    if (len == 0) return;
+    value_t *value = collection_at(rec->fields, rec->num_fields - 1);
+    if (rec->started) value_append(value, text, len);
+    else value_set(value, text, len);
+    rec->started = true;
+}
+
+static void csv_next_field(csv_record_t *rec) {
+    if (!rec->started) value_set(collection_at(rec->fields,
+                                               rec->num_fields - 1), "", 0);
+    rec->num_fields++;
+    rec->started = false;
+}
+
+/**
+ * Add a line to a record, following RFC 4180: fields are separated by
+ * commas, and a field that starts with a quote ends at the next single
+ * quote, with "" standing for a quote and commas and newlines kept as text.
+ * Quotes anywhere else are kept as text.
+ */
+static void csv_add_line(csv_record_t *rec, char *line, size_t len) {
+    uint32_t pos[CSV_WINDOW];
+    size_t start = 0; // Text before this was already added
+    size_t skip = 0; // Quotes before this were already handled
+    size_t base;
+    for (base = 0; base < len; base += CSV_WINDOW) {
+        size_t window = len - base < CSV_WINDOW ? len - base : CSV_WINDOW;
+        size_t n = text_index(line + base, window, ',', '"', pos);
+        size_t i;
+        for (i=0; i<n; i++) {
+            size_t p = base + pos[i];
+            if (p < skip) continue;
+
+            if (line[p] == ',') {
+                if (rec->quoted) continue;
+                csv_add(rec, line + start, p - start);
+                csv_next_field(rec);
+                start = p + 1;
+            } else if (rec->quoted) {
+                csv_add(rec, line + start, p - start);
+                if (p + 1 < len && line[p+1] == '"') {
+                    // The second quote starts the next piece of text
+                    skip = p + 2;
+                } else {
+                    rec->quoted = false;
+                }
+                start = p + 1;
+            } else if (p == start && !rec->started) {
+                rec->quoted = true;
+                start = p + 1;
+            }
+        }
+    }
+    csv_add(rec, line + start, len - start);
+}
+
+// Handle execution of BasilC-csv()
+bool basilc_csv_callback(stack_node_t **node) {
+    file_handle_t *file = get_file((*node)->parameters[0], true);
+    if (file == NULL) return false;
+
+    // Fields are written over the elements of the previous record
+    csv_record_t rec;
+    rec.fields = collection_array_of_var((*node)->parameters[1]);
+    rec.num_fields = 1;
+    rec.started = false;
+    rec.quoted = false;
+
+    // Reading past the end gives an empty array, see eof()
+    size_t len;
+    char *line = reader_next_line(file->reader, &len);
+    if (line == NULL) {
+        collection_truncate(rec.fields, 0);
+        return true;
+    }
+    for (;;) {
+        if (len > 0 && line[len-1] == '\r') len--;
+        csv_add_line(&rec, line, len);
+
+        // A quoted field goes on until its closing quote
+        if (!rec.quoted) break;
+        line = reader_next_line(file->reader, &len);
+        if (line == NULL) break;
+        csv_add(&rec, "\n", 1);
+    }
+    csv_next_field(&rec);
+    collection_truncate(rec.fields, rec.num_fields - 1);
+    return true;
+}
+
+// Handle execution of BasilC-write()
+bool basilc_write_callback(stack_node_t **node) {
+    file_handle_t *file = get_file((*node)->parameters[0], false);
+    if (file == NULL) return false;
+
+    // Variables are written out directly, like say()
+    if (!print_var_string((*node)->parameters[1], file->fp)) {
+        fputs((*node)->parameters[1], file->fp);
+    }
+    return true;
+}
+
+// Handle execution of BasilC-writeln()
+bool basilc_writeln_callback(stack_node_t **node) {
+    if (!basilc_write_callback(node)) return false;
+    fputc('\n', find_file((*node)->parameters[0])->fp);
+    return true;
+}
+
+// Handle execution of BasilC-close()
+bool basilc_close_callback(stack_node_t **node) {
+    file_handle_t *file = find_file((*node)->parameters[0]);
+    if (file != NULL) close_file(file);
+    return true;
+}
@@ -13,19 +13,19 @@
  #include <stdlib.h>
  #include <string.h>
  #include <stdio.h>
- #include <ctype.h>
 
  #include <main.h>
  #include <cmd.h>
+ #include <memstat.h>
+ #include <parallel.h>
+ #include <textscan.h>
 
 // Handle execution of BasilC-say()
 bool basilc_say_callback(stack_node_t **node) {
-    char *parsed = parse_var_string((*node)->parameters[0]);
-    if (parsed != NULL) {
-        printf("%s", parsed);
-        free(parsed);
-    } else {
-        printf("%s", (*node)->parameters[0]);
+    // Variables are written out directly, so long values are never copied
+    FILE *out = task_output();
+    if (!print_var_string((*node)->parameters[0], out)) {
+        fputs((*node)->parameters[0], out);
     }
     return true;
 }
@@ -33,7 +33,7 @@ bool basilc_say_callback(stack_node_t **node) {
 // Handle execution of BasilC-sayln()
 bool basilc_sayln_callback(stack_node_t **node) {
    basilc_say_callback(node);
-   printf("\n");
+   fputc('\n', task_output());
    return true;
 }
 
@@ -43,22 +43,23 @@ void basilc_handle_tint(char code, char *temp){
   statement to be in the corresponding color */
   if (monochrome_mode)
       return;
+  FILE *out = task_output();
   if (strcmp(temp, "black") == 0)
-      printf("\033[%c0m", code);
+      fprintf(out, "\033[%c0m", code);
   else if (strcmp(temp, "red") == 0)
-      printf("\033[%c1m", code);
+      fprintf(out, "\033[%c1m", code);
   else if (strcmp(temp, "green") == 0)
-      printf("\033[%c2m", code);
+      fprintf(out, "\033[%c2m", code);
   else if (strcmp(temp, "yellow") == 0)
-      printf("\033[%c3m", code);
+      fprintf(out, "\033[%c3m", code);
   else if (strcmp(temp, "blue") == 0)
-      printf("\033[%c4m", code);
+      fprintf(out, "\033[%c4m", code);
   else if (strcmp(temp, "magenta") == 0)
-      printf("\033[%c5m", code);
+      fprintf(out, "\033[%c5m", code);
   else if (strcmp(temp, "cyan") == 0)
-      printf("\033[%c6m", code);
+      fprintf(out, "\033[%c6m", code);
   else if (strcmp(temp, "white") == 0)
-      printf("\033[%c7m", code);
+      fprintf(out, "\033[%c7m", code);
   /* if the color is not one of the available options, reset
   terminal to default color state */
   else
@@ -67,11 +68,10 @@ void basilc_handle_tint(char code, char *temp){
 
 // Handle execution of BasilC-tint()
 bool basilc_tint_callback(stack_node_t **node) {
-    char *temp = (*node)->parameters[0];
-    int32_t i;
-    for (i=0; temp[i]; i++){
-        temp[i] = tolower(temp[i]);
-    }
+    // Colors are matched in lower case, without changing the parameter
+    char temp[STACK_PARAMETER_MAX_LENGTH];
+    text_lower(temp, (*node)->parameters[0],
+               strlen((*node)->parameters[0]) + 1);
     /* prints ANSI escape code to allow the following BasilC-say
     statement to be in the corresponding color */
     basilc_handle_tint('3', temp);
@@ -80,11 +80,9 @@ bool basilc_tint_callback(stack_node_t **node) {
 
 // Handle execution of BasilC-tintbg()
 bool basilc_tintbg_callback(stack_node_t **node) {
-    char *temp = (*node)->parameters[0];
-    int32_t i;
-    for (i=0; temp[i]; i++){
-        temp[i] = tolower(temp[i]);
-    }
+    char temp[STACK_PARAMETER_MAX_LENGTH];
+    text_lower(temp, (*node)->parameters[0],
+               strlen((*node)->parameters[0]) + 1);
     basilc_handle_tint('4', temp);
     return true;
 }
@@ -94,8 +92,13 @@ bool basilc_ask_callback(stack_node_t **node) {
     variable_stack_node_t *temp_var = var_stack_search_label((*node)->parameters[1]);
     if (temp_var != NULL) {
         printf("%s", (*node)->parameters[0]);
-        fgets(temp_var->data, STACK_PARAMETER_MAX_LENGTH, stdin);
-        temp_var->data[strlen(temp_var->data)-1] = '\0';
+        char input[STACK_PARAMETER_MAX_LENGTH];
+        if (fgets(input, STACK_PARAMETER_MAX_LENGTH, stdin) == NULL) {
+            input[0] = '\0';
+        }
+        size_t len = strlen(input);
+        if (len > 0 && input[len-1] == '\n') input[--len] = '\0';
+        value_set(&temp_var->value, input, len);
         return true;
     } else {
         printf("Variable %s has not been declared!\n", (*node)->parameters[1]);
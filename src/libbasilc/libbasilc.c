@@ -14,6 +14,10 @@
 #include <libbasilc/io.h>
 #include <libbasilc/system.h>
 #include <libbasilc/variable.h>
+#include <libbasilc/collections.h>
+#include <libbasilc/file.h>
+#include <libbasilc/concurrency.h>
+#include <libbasilc/text.h>
 
 #include <cmd.h>
 
@@ -24,8 +28,15 @@ void libbasilc_register() {
     /* Register controlflow functions */
     register_cmd(&basilc_if);
     register_cmd(&basilc_endif);
+    register_cmd(&basilc_while);
+    register_cmd(&basilc_endwhile);
+    register_cmd(&basilc_break);
+    register_cmd(&basilc_continue);
     register_cmd(&basilc_label);
     register_cmd(&basilc_goto);
+    register_cmd(&basilc_call);
+    register_cmd(&basilc_return);
+    register_cmd(&basilc_local);
     register_cmd(&basilc_end);
 
     /* Register io functions */
@@ -37,10 +48,53 @@ void libbasilc_register() {
 
     /* Register system functions */
     register_cmd(&basilc_yolo);
+    register_cmd(&basilc_capture);
+    register_cmd(&basilc_capturelines);
     register_cmd(&basilc_naptime);
+    register_cmd(&basilc_import);
+    register_cmd(&basilc_include);
 
     /* Register variable functions */
     register_cmd(&basilc_define);
+    register_cmd(&basilc_let);
+    register_cmd(&basilc_append);
+    register_cmd(&basilc_prepend);
+    register_cmd(&basilc_persist);
+    register_cmd(&basilc_checkpoint);
+
+    /* Register collection functions */
+    register_cmd(&basilc_put);
+    register_cmd(&basilc_get);
+    register_cmd(&basilc_del);
+    register_cmd(&basilc_len);
+    register_cmd(&basilc_push);
+    register_cmd(&basilc_each);
+    register_cmd(&basilc_endeach);
+
+    /* Register file functions */
+    register_cmd(&basilc_open);
+    register_cmd(&basilc_readline);
+    register_cmd(&basilc_csv);
+    register_cmd(&basilc_eof);
+    register_cmd(&basilc_write);
+    register_cmd(&basilc_writeln);
+    register_cmd(&basilc_close);
+
+    /* Register concurrency functions */
+    register_cmd(&basilc_parallel);
+    register_cmd(&basilc_endparallel);
+    register_cmd(&basilc_pareach);
+    register_cmd(&basilc_endpareach);
+
+    /* Register text functions */
+    register_cmd(&basilc_match);
+    register_cmd(&basilc_upper);
+    register_cmd(&basilc_lower);
+    register_cmd(&basilc_trim);
+    register_cmd(&basilc_find);
+    register_cmd(&basilc_replace);
+    register_cmd(&basilc_substr);
+    register_cmd(&basilc_split);
 }
 
 void __debug_print_cmd_stack() {
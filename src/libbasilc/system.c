@@ -5,10 +5,13 @@
  */
 /**
  * This file contains code that defines BasilC commands related to host system
- * operations such as yolo() and naptime().
+ * operations such as yolo(), capture(), naptime(), import() and include().
  */
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
 
 #ifdef __unix__
 #include <unistd.h>
@@ -17,7 +20,13 @@
 #define sleep(x) (Sleep(x*1000))
 #endif
 
+#include <main.h>
 #include <cmd.h>
+#include <plugin.h>
+#include <module.h>
+#include <process.h>
+#include <collection.h>
+#include <memstat.h>
 
 // Handle execution of yolo()
 bool basilc_yolo_callback(stack_node_t **node) {
@@ -25,8 +34,139 @@ bool basilc_yolo_callback(stack_node_t **node) {
     return true;
 }
 
+// Output of capture(), with trailing newlines held back so that they can
+// be dropped at the end
+struct capture_text {
+    value_t *value;
+    size_t newlines;
+};
+typedef struct capture_text capture_text_t;
+
+static void capture_text_sink(char *data, size_t len, void *ctx) {
+    capture_text_t *out = ctx;
+    size_t keep = len;
+    while (keep > 0 && data[keep-1] == '\n') keep--;
+    if (keep == 0) {
+        out->newlines += len;
+        return;
+    }
+    for (; out->newlines > 0; out->newlines--) {
+        value_append(out->value, "\n", 1);
+    }
+    value_append(out->value, data, keep);
+    out->newlines = len - keep;
+}
+
+// Output of capturelines(), split into lines as it comes in
+struct capture_lines {
+    collection_t *coll;
+    char *partial; // Start of a line that isn't complete yet
+    size_t partial_len;
+};
+typedef struct capture_lines capture_lines_t;
+
+static void capture_lines_sink(char *data, size_t len, void *ctx) {
+    capture_lines_t *out = ctx;
+    char *end = data + len;
+    char *nl;
+    while ((nl = memchr(data, '\n', end - data)) != NULL) {
+        value_t *line = collection_push(out->coll);
+        value_set(line, out->partial, out->partial_len);
+        value_append(line, data, nl - data);
+        out->partial_len = 0;
+        data = nl + 1;
+    }
+    if (data < end) {
+        out->partial = basilc_realloc(out->partial, out->partial_len +
+                                      (end - data), MEM_INTERP);
+        memcpy(out->partial + out->partial_len, data, end - data);
+        out->partial_len += end - data;
+    }
+}
+
+/**
+ * Replace the variables in the command of a capture() node. This has to
+ * happen before the output variable is cleared, since the command may use it.
+ * @return the command. *parsed is set to a string that has to be freed with
+ *         basilc_free(), or NULL.
+ */
+static char * capture_command(stack_node_t *node, char **parsed) {
+    *parsed = parse_var_string(node->parameters[0]);
+    return *parsed != NULL ? *parsed : node->parameters[0];
+}
+
+/**
+ * Run the command of a capture() node and store its exit status
+ * @return false if the command couldn't be run
+ */
+static bool run_capture(stack_node_t *node, char *cmd, capture_sink_t sink,
+                        void *ctx) {
+    fflush(stdout);
+    int32_t status;
+    bool ok = process_capture(cmd, sink, ctx, &status);
+    if (!ok) {
+        printf("Failed to run command!\n");
+        return false;
+    }
+
+    // Without a status variable, a command that can't be found is an error
+    if (node->parameters[2][0]) {
+        char num[12];
+        sprintf(num, "%d", status);
+        define_var(node->parameters[2], num);
+    } else if (status == CAPTURE_STATUS_NOT_FOUND) {
+        printf("Command not found!\n");
+        return false;
+    }
+    return true;
+}
+
+// Handle execution of capture()
+bool basilc_capture_callback(stack_node_t **node) {
+    char *parsed;
+    char *cmd = capture_command(*node, &parsed);
+    variable_stack_node_t *var = define_var((*node)->parameters[1], "");
+    capture_text_t out = { .value = &var->value, .newlines = 0 };
+    bool ok = run_capture(*node, cmd, capture_text_sink, &out);
+    basilc_free(parsed);
+    return ok;
+}
+
+// Handle execution of capturelines()
+bool basilc_capturelines_callback(stack_node_t **node) {
+    char *parsed;
+    char *cmd = capture_command(*node, &parsed);
+    define_var((*node)->parameters[1], "");
+    capture_lines_t out = {
+        .coll = collection_of_var((*node)->parameters[1], COLL_ARRAY, true),
+        .partial = NULL,
+        .partial_len = 0,
+    };
+    bool ok = run_capture(*node, cmd, capture_lines_sink, &out);
+    basilc_free(parsed);
+
+    // The last line may not end with a newline
+    if (out.partial_len > 0) {
+        value_set(collection_push(out.coll), out.partial, out.partial_len);
+    }
+    basilc_free(out.partial);
+    return ok;
+}
+
 // Handle execution of naptime()
 bool basilc_naptime_callback(stack_node_t **node) {
     sleep(atoi((*node)->parameters[0]));
     return true;
 }
+
+// Handle special parsing of import(), which loads a plugin at parse time
+bool basilc_import_special_parse() {
+    return plugin_load(current_stack->parameters[0]);
+}
+
+// Handle special parsing of include(), which parses another script file
+bool basilc_include_special_parse() {
+    // Included code can't be part of a block
+    if (in_block || block_inside(NULL)) return false;
+    return module_include(current_stack->parameters[0]);
+}
@@ -0,0 +1,225 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains code that defines BasilC commands for working with
+ * text, such as match(), upper(), find(), replace() and split()
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <collection.h>
+#include <pattern.h>
+#include <textscan.h>
+#include <memstat.h>
+
+// Handle execution of BasilC-match()
+bool basilc_match_callback(stack_node_t **node) {
+    char *text_parsed = parse_var_string((*node)->parameters[0]);
+    char *text = text_parsed != NULL ? text_parsed : (*node)->parameters[0];
+
+    // Patterns without variables were compiled while parsing
+    pattern_t *pat = (*node)->data;
+    bool temporary = false;
+    if (pat == NULL) {
+        char *source_parsed = parse_var_string((*node)->parameters[1]);
+        pat = pattern_get(source_parsed != NULL ? source_parsed :
+                          (*node)->parameters[1], &temporary);
+        basilc_free(source_parsed);
+    }
+    if (pat == NULL) {
+        printf("Invalid pattern!\n");
+        basilc_free(text_parsed);
+        return false;
+    }
+
+    // The result is an array of the whole match and its groups, or empty
+    pattern_group_t groups[PATTERN_MAX_GROUPS];
+    int32_t num_groups = pattern_match(pat, text, groups);
+    char *name = (*node)->parameters[2];
+    define_var(name, "");
+    collection_t *coll = collection_of_var(name, COLL_ARRAY, true);
+    int32_t i;
+    for (i=0; i<num_groups; i++) {
+        value_t *elem = collection_push(coll);
+        if (groups[i].start >= 0) {
+            value_set(elem, text + groups[i].start,
+                      groups[i].end - groups[i].start);
+        }
+    }
+
+    if (temporary) pattern_free(pat);
+    basilc_free(text_parsed);
+    return true;
+}
+// Handle special parsing of BasilC-match()
+bool basilc_match_special_parse() {
+    // Compile patterns without variables right away
+    char *source = current_stack->parameters[1];
+    if (strchr(source, '$') != NULL) return true;
+
+    current_stack->data = pattern_compile(source);
+    return current_stack->data != NULL;
+}
+
+/**
+ * Replace the variables in a parameter
+ * @return the text to use. *parsed is set to a string that has to be freed
+ *         with basilc_free(), or NULL.
+ */
+static char * interpolate(char *param, char **parsed) {
+    *parsed = parse_var_string(param);
+    return *parsed != NULL ? *parsed : param;
+}
+
+// Set a variable to `len` characters of `str`
+static void set_var(char *name, char *str, size_t len) {
+    variable_stack_node_t *var = define_var(name, "");
+    value_set(&var->value, str, len);
+}
+
+// Shared code of upper() and lower()
+static void convert_case(stack_node_t *node, bool upper) {
+    char *parsed;
+    char *text = interpolate(node->parameters[0], &parsed);
+    size_t len = strlen(text);
+
+    // Parameters are converted into a copy, interpolated text in place
+    char copy[STACK_PARAMETER_MAX_LENGTH];
+    char *dst = parsed != NULL ? parsed : copy;
+    if (upper) text_upper(dst, text, len);
+    else text_lower(dst, text, len);
+    set_var(node->parameters[1], dst, len);
+    basilc_free(parsed);
+}
+
+// Handle execution of BasilC-upper()
+bool basilc_upper_callback(stack_node_t **node) {
+    convert_case(*node, true);
+    return true;
+}
+
+// Handle execution of BasilC-lower()
+bool basilc_lower_callback(stack_node_t **node) {
+    convert_case(*node, false);
+    return true;
+}
+
+// Handle execution of BasilC-trim()
+bool basilc_trim_callback(stack_node_t **node) {
+    char *parsed;
+    char *text = interpolate((*node)->parameters[0], &parsed);
+    size_t len = strlen(text);
+    size_t start = text_blank_prefix(text, len);
+    size_t end = len;
+    if (start < len) end -= text_blank_suffix(text + start, len - start);
+    set_var((*node)->parameters[1], text + start, end - start);
+    basilc_free(parsed);
+    return true;
+}
+
+// Handle execution of BasilC-find()
+bool basilc_find_callback(stack_node_t **node) {
+    char *parsed_text, *parsed_search;
+    char *text = interpolate((*node)->parameters[0], &parsed_text);
+    char *search = interpolate((*node)->parameters[1], &parsed_search);
+
+    char *found = text_find(text, strlen(text), search, strlen(search));
+    char buf[24];
+    sprintf(buf, "%td", found != NULL ? found - text : (ptrdiff_t) -1);
+    define_var((*node)->parameters[2], buf);
+
+    basilc_free(parsed_text);
+    basilc_free(parsed_search);
+    return true;
+}
+
+// Handle execution of BasilC-replace()
+bool basilc_replace_callback(stack_node_t **node) {
+    char *parsed_text, *parsed_search, *parsed_with;
+    char *text = interpolate((*node)->parameters[0], &parsed_text);
+    char *search = interpolate((*node)->parameters[1], &parsed_search);
+    char *with = interpolate((*node)->parameters[2], &parsed_with);
+    size_t len = strlen(text);
+    size_t search_len = strlen(search);
+    size_t with_len = strlen(with);
+
+    // The result is built up in the variable, since the text is never its
+    // own value
+    variable_stack_node_t *var = define_var((*node)->parameters[3], "");
+    char *pos = text;
+    char *found;
+    while (search_len > 0 &&
+           (found = text_find(pos, text + len - pos, search, search_len))) {
+        value_append(&var->value, pos, found - pos);
+        value_append(&var->value, with, with_len);
+        pos = found + search_len;
+    }
+    value_append(&var->value, pos, text + len - pos);
+
+    basilc_free(parsed_text);
+    basilc_free(parsed_search);
+    basilc_free(parsed_with);
+    return true;
+}
+
+// Handle execution of BasilC-substr()
+bool basilc_substr_callback(stack_node_t **node) {
+    char *parsed_text, *parsed_start, *parsed_count;
+    char *text = interpolate((*node)->parameters[0], &parsed_text);
+    int64_t len = strlen(text);
+    int64_t start = atoll(interpolate((*node)->parameters[1], &parsed_start));
+    int64_t count = atoll(interpolate((*node)->parameters[2], &parsed_count));
+
+    // A negative start counts from the end, and the range is cut to the text
+    if (start < 0) start += len;
+    if (start < 0) start = 0;
+    if (start > len) start = len;
+    if (count < 0) count = 0;
+    if (count > len - start) count = len - start;
+    set_var((*node)->parameters[3], text + start, count);
+
+    basilc_free(parsed_text);
+    basilc_free(parsed_start);
+    basilc_free(parsed_count);
+    return true;
+}
+
+// Handle execution of BasilC-split()
+bool basilc_split_callback(stack_node_t **node) {
+    char *parsed_text, *parsed_delim;
+    char *text = interpolate((*node)->parameters[0], &parsed_text);
+    char *delim = interpolate((*node)->parameters[1], &parsed_delim);
+    size_t delim_len = strlen(delim);
+    if (delim_len == 0) {
+        printf("Empty delimiter!\n");
+        basilc_free(parsed_text);
+        basilc_free(parsed_delim);
+        return false;
+    }
+
+    // Fields are written over the elements of the previous split()
+    collection_t *coll = collection_array_of_var((*node)->parameters[2]);
+    int32_t num_fields = 0;
+    char *pos = text;
+    char *end = text + strlen(text);
+    char *found;
+    while ((found = text_find(pos, end - pos, delim, delim_len)) != NULL) {
+        value_set(collection_at(coll, num_fields++), pos, found - pos);
+        pos = found + delim_len;
+    }
+    value_set(collection_at(coll, num_fields++), pos, end - pos);
+    collection_truncate(coll, num_fields);
+
+    basilc_free(parsed_text);
+    basilc_free(parsed_delim);
+    return true;
+}
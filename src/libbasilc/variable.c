@@ -5,35 +5,98 @@
  */
 /**
  * This file contains code that defines BasilC commands related to variable
- * storage and usage, such as define()
+ * storage and usage, such as define(), let(), append(), prepend() and
+ * persist()
  */
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 #include <cmd.h>
+#include <memstat.h>
+#include <persist.h>
+#include <expr.h>
 
 // Handle execution of define()
 bool basilc_define_callback(stack_node_t **node) {
     char *var_name = (*node)->parameters[0];
     char *var_data = (*node)->parameters[1];
 
-    // Check if variable already exists
-    variable_stack_node_t *var = var_stack_search_label(var_name);
-    if (var != NULL) {
-        // Redefine variable
-        strcpy(var->data, var_data);
-        return true;
+    define_var(var_name, var_data);
+    return true;
+}
+
+// Handle execution of let()
+bool basilc_let_callback(stack_node_t **node) {
+    expr_value_t value;
+    expr_eval(expr_of_node(*node, 1), &value);
+    if (value.is_num) {
+        char buf[24];
+        expr_format(&value, buf, sizeof(buf));
+        define_var((*node)->parameters[0], buf);
+    } else {
+        // The text may be the variable's own value, which define_var() replaces
+        char *copy = basilc_malloc(strlen(value.str) + 1, MEM_VARS);
+        strcpy(copy, value.str);
+        define_var((*node)->parameters[0], copy);
+        basilc_free(copy);
     }
+    return true;
+}
+// Handle special parsing of let()
+bool basilc_let_special_parse() {
+    return expr_parse_node(1);
+}
+
+/**
+ * Find the variable named by the first parameter, creating it if needed, and
+ * interpolate the text in the second parameter
+ * @return the variable, with *text set to the (possibly parsed) text
+ */
+static variable_stack_node_t * get_var_and_text(stack_node_t *node,
+                                                char **text, char **parsed) {
+    variable_stack_node_t *var = var_stack_search_label(node->parameters[0]);
+    if (var == NULL) var = define_var(node->parameters[0], "");
+
+    *parsed = parse_var_string(node->parameters[1]);
+    *text = *parsed != NULL ? *parsed : node->parameters[1];
+    return var;
+}
 
-    // Add to variable stack
-    strcpy(current_var_stack->name, var_name);
-    strcpy(current_var_stack->data, var_data);
+// Handle execution of append()
+bool basilc_append_callback(stack_node_t **node) {
+    char *text, *parsed;
+    variable_stack_node_t *var = get_var_and_text(*node, &text, &parsed);
+    value_append(&var->value, text, strlen(text));
+    if (parsed != NULL) basilc_free(parsed);
+    return true;
+}
+
+// Handle execution of prepend()
+bool basilc_prepend_callback(stack_node_t **node) {
+    char *text, *parsed;
+    variable_stack_node_t *var = get_var_and_text(*node, &text, &parsed);
+    value_prepend(&var->value, text, strlen(text));
+    if (parsed != NULL) basilc_free(parsed);
+    return true;
+}
 
-    // Advance variable stack
-    current_var_stack->next = (variable_stack_node_t *)
-                              malloc(sizeof(variable_stack_node_t));
-    current_var_stack = current_var_stack->next;
+// Handle execution of persist()
+bool basilc_persist_callback(stack_node_t **node) {
+    if (!persist_bind((*node)->parameters[0])) {
+        printf("Can't use state file %s!\n", persist_path);
+        return false;
+    }
+    return true;
+}
 
+// Handle execution of checkpoint()
+bool basilc_checkpoint_callback(stack_node_t **node) {
+    (void) node;
+    if (!persist_checkpoint()) {
+        printf("Value too long to persist!\n");
+        return false;
+    }
     return true;
 }
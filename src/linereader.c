@@ -0,0 +1,107 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the line reader used for reading files. Data is read
+ * in READER_BLOCK_SIZE blocks straight into one buffer, and lines are split
+ * with memchr() and handed out in place, so streaming a file of any size
+ * takes a single pass and memory proportional to its longest line.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <linereader.h>
+#include <memstat.h>
+
+line_reader_t * reader_create(FILE *fp) {
+    line_reader_t *reader = basilc_malloc(sizeof(line_reader_t), MEM_FILES);
+    reader->fp = fp;
+    reader->cap = READER_BLOCK_SIZE;
+    reader->buf = basilc_malloc(reader->cap + 1, MEM_FILES);
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = false;
+
+    // Every read goes straight into our buffer
+    setvbuf(fp, NULL, _IONBF, 0);
+    return reader;
+}
+
+/**
+ * Read the next block, making room for it first
+ * @return false if there is no more data
+ */
+static bool reader_fill(line_reader_t *reader) {
+    if (reader->eof) return false;
+
+    // Move the partial line to the front, or grow if it fills the buffer
+    if (reader->start > 0) {
+        memmove(reader->buf, reader->buf + reader->start,
+                reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    } else if (reader->end == reader->cap) {
+        reader->cap *= 2;
+        reader->buf = basilc_realloc(reader->buf, reader->cap + 1, MEM_FILES);
+    }
+
+    size_t n = fread(reader->buf + reader->end, 1, reader->cap - reader->end,
+                     reader->fp);
+    if (n == 0) {
+        reader->eof = true;
+        return false;
+    }
+    reader->end += n;
+    return true;
+}
+
+/**
+ * Get the next line, without its newline. The line is NUL terminated and
+ * stays valid until the next call.
+ * @return the line, or NULL at the end of the file
+ */
+char * reader_next_line(line_reader_t *reader, size_t *len) {
+    size_t searched = 0;
+    for (;;) {
+        char *line = reader->buf + reader->start;
+        char *nl = memchr(line + searched, '\n',
+                          reader->end - reader->start - searched);
+        if (nl != NULL) {
+            *nl = '\0';
+            *len = nl - line;
+            reader->start += *len + 1;
+            return line;
+        }
+
+        // Don't search the same bytes again after reading more
+        searched = reader->end - reader->start;
+        if (!reader_fill(reader)) break;
+    }
+
+    // Last line without a newline
+    if (reader->start == reader->end) return NULL;
+    char *line = reader->buf + reader->start;
+    *len = reader->end - reader->start;
+    line[*len] = '\0';
+    reader->start = reader->end;
+    return line;
+}
+
+/**
+ * Whether every line has been returned
+ */
+bool reader_at_end(line_reader_t *reader) {
+    if (reader->start < reader->end) return false;
+    return !reader_fill(reader);
+}
+
+void reader_free(line_reader_t *reader) {
+    basilc_free(reader->buf);
+    basilc_free(reader);
+}
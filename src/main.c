@@ -10,11 +10,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <time.h>
 
 #include <main.h>
 #include <stringhelpers.h>
 #include <cmd.h>
+#include <engine.h>
+#include <optimize.h>
+#include <jit.h>
+#include <emitc.h>
+#include <plugin.h>
+#include <memstat.h>
+#include <sample.h>
+#include <governor.h>
+#include <timing.h>
+#include <module.h>
+#include <process.h>
+#include <persist.h>
+#include <parser.h>
 #include <libbasilc/libbasilc.h>
 
 // Comments: BasilC#// (comment)
@@ -28,24 +40,19 @@
 // Define variables: BasilC-define(var_name, var_data)
 // End Program: BasilC-end()
 
-stack_node_t *root;
-stack_node_t *current_stack;
-
-variable_stack_node_t *root_var;
-variable_stack_node_t *current_var_stack;
-
-bool in_block;
-bool monochrome_mode;
-bool hide_debugging;
 bool show_timer;
+bool threaded_mode;
+bool filter_mode;
+bool filter_print;
+int32_t optimize_level;
 
 int32_t main(int32_t argc, char **argv) {
-    //start debug timer
-    clock_t start_timer = clock();
-
     // Verify arguments
-    if (argc < 2 || argc > 5) {
-        printf("Usage: %s [-m] [-d] <script.basilc>\n", argv[0]);
+    if (argc < 2) {
+        printf("Usage: %s [-m] [-d] [-t] [-f] [-n] [-p] [-O[level]] [-L plugin] [-M] "
+               "[--jit] [--emit-c] [--sample[=hz]] [--time-json] "
+               "[--capture-max=bytes] [--capture-timeout=sec] [--state=file] "
+               "[--max-insns=n] [--timeout=sec] [--max-mem=bytes] <script.basilc>\n", argv[0]);
         return 1;
     }
 
@@ -54,6 +61,28 @@ int32_t main(int32_t argc, char **argv) {
     monochrome_mode = false;
     hide_debugging = false;
     show_timer = false;
+    threaded_mode = false;
+    filter_mode = false;
+    filter_print = false;
+    optimize_level = 0;
+
+    // Memory accounting has to start before anything is allocated
+    int32_t c;
+    int32_t counter = 0;
+    if (find_option(argc, argv, "M", &counter) != -1)
+        memstat_init();
+
+    // So do resource limits, which also start the deadline
+    basilc_limits_t limits;
+    memset(&limits, 0, sizeof(limits));
+    char *limit;
+    if ((limit = find_long_option(argc, argv, "max-insns")) != NULL)
+        limits.max_insns = parse_size(limit);
+    if ((limit = find_long_option(argc, argv, "timeout")) != NULL)
+        limits.timeout_ms = atof(limit) * 1000;
+    if ((limit = find_long_option(argc, argv, "max-mem")) != NULL)
+        limits.max_mem = parse_size(limit);
+    governor_set_limits(&limits);
 
     // Initialize command stack
     init_cmd_stack();
@@ -62,10 +91,9 @@ int32_t main(int32_t argc, char **argv) {
     libbasilc_register();
 
     // Check parameters
-    int32_t c;
-    int32_t counter = 0;
+    counter = 0;
 
-    while ((c = find_option(argc, argv, "mdt", &counter)) != -1)
+    while ((c = find_option(argc, argv, "mdtfnpOL", &counter)) != -1)
     switch (c) {
         case 'm':
             monochrome_mode = true; //don't output ANSI color codes
@@ -76,16 +104,72 @@ int32_t main(int32_t argc, char **argv) {
         case 't':
             show_timer = true; //show elapse time
             break;
+        case 'f':
+            threaded_mode = true; //use the threaded execution engine
+            break;
+        case 'p':
+            filter_print = true; //print each line after running the program
+            /* fallthrough */
+        case 'n':
+            filter_mode = true; //run the program for each line of stdin
+            threaded_mode = true;
+            break;
+        case 'O':
+            //optimization level follows the option, -O alone means -O1
+            optimize_level = argv[counter-1][2] ? atoi(argv[counter-1]+2) : 1;
+            if (optimize_level > OPTIMIZE_MAX_LEVEL)
+                optimize_level = OPTIMIZE_MAX_LEVEL;
+            break;
+        case 'L':
+            //load a plugin, given as -Lpath or -L path
+            if (argv[counter-1][2]) {
+                if (!plugin_load(argv[counter-1]+2)) return 1;
+            } else if (counter < argc - 1) {
+                if (!plugin_load(argv[counter++])) return 1;
+            }
+            break;
+    }
+
+    // Check long parameters
+    if (find_long_option(argc, argv, "jit") != NULL) {
+        threaded_mode = true; //the JIT compiles loops of the threaded engine
+        jit_init();
+    }
+
+    // Limits of capture()
+    char *capture_opt;
+    if ((capture_opt = find_long_option(argc, argv, "capture-max")) != NULL)
+        capture_max = parse_size(capture_opt);
+    if ((capture_opt = find_long_option(argc, argv, "capture-timeout")) != NULL)
+        capture_timeout_ms = atof(capture_opt) * 1000;
+
+    // State file of persist(), next to the script by default
+    persist_path = find_long_option(argc, argv, "state");
+    if (persist_path == NULL || !persist_path[0]) {
+        char *script = argv[argc-1];
+        persist_path = basilc_malloc(strlen(script) +
+                                     strlen(PERSIST_DEFAULT_SUFFIX) + 1,
+                                     MEM_SOURCE);
+        sprintf(persist_path, "%s%s", script, PERSIST_DEFAULT_SUFFIX);
+    }
+
+    // Time the phases of the run and every command
+    bool timing_json = find_long_option(argc, argv, "time-json") != NULL;
+    if (show_timer || timing_json) {
+        timing_init(timing_json);
+        timing_phase(PHASE_LOAD);
     }
 
     // Create initial stack
-    root = (stack_node_t *) malloc(sizeof(stack_node_t));
+    root = (stack_node_t *) basilc_malloc(sizeof(stack_node_t), MEM_NODES);
     current_stack = root;
     stack_node_initialize(root);
 
     // Create initial variable stack
-    root_var = (variable_stack_node_t *) malloc(sizeof(variable_stack_node_t));
+    root_var = (variable_stack_node_t *)
+               basilc_malloc(sizeof(variable_stack_node_t), MEM_VARS);
     current_var_stack = root_var;
+    var_node_initialize(root_var);
 
     // Open script file
     FILE *fp;
@@ -94,300 +178,58 @@ int32_t main(int32_t argc, char **argv) {
         perror("Error");
         return 1;
     }
-    int32_t lines = 0;
-    int32_t chars = 0;
 
-    // Count lines and chars
-    char cur_char = 0;
-    while (!feof(fp)) {
-        cur_char = fgetc(fp);
-        if (cur_char == '\n') ++lines;
-        chars++;
-    }
-
-    // Create Buffer with correct size
-    char *buffer = 0;
-
-    // Fill buffer
-    if (fp) {
-        fseek(fp, 0, SEEK_SET);
-        buffer = malloc(chars+1);
-        if (buffer) {
-            fread (buffer, 1, chars, fp);
-        }
-        fclose(fp);
-        buffer[chars] = '\0';
-    }
+    // Read the whole script into a buffer
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buffer = basilc_malloc(size + 1, MEM_SOURCE);
+    size = fread(buffer, 1, size, fp);
+    buffer[size] = '\0';
+    fclose(fp);
 
     // DEBUG BasilC(TM)
     fputs("BasilC Interpreter v1.0\n\n", stderr);
 
     // Begin parsing
-    cur_char = 0;
-
-    int32_t line_len = 0;
-    int32_t pos = 0;
-    int32_t i;
-    for (i=0; i<lines; i++) {
-        // Get line length
-        while (buffer[pos+line_len] && buffer[pos+line_len] != '\n') {
-            ++line_len;
-        }
-
-        // Put line in temp buffer
-        ++line_len;
-        char temp[line_len];
-        strncpy(temp, buffer+pos, line_len);
-
-        // Parse line
-        parse_line(temp, line_len, i+1);
-
-        // Update position and reset line_len
-        pos += line_len;
-        line_len = 0;
-
-    }
+    if (timing_enabled) timing_phase(PHASE_PARSE);
+    module_set_main(argv[argc-1]);
+    parse_source(buffer, size);
 
     // Cleanup and run final parsing checks
     parse_cleanup();
 
-    // Execute stack
-    stack_execute();
-
-    // Reset terminal colors
-    printANSIescape("\033[0m");
-
-    // Print program execution time
-    clock_t end_timer = clock();
-    double execution_time = (double)(end_timer - start_timer) / CLOCKS_PER_SEC;
-    if (show_timer)
-        printf("\nExecution Time: %f seconds\n", execution_time);
-
-    return 0;
-}
-
-// Intialize an empty stack node
-void stack_node_initialize(stack_node_t *s) {
-    s->command = NULL;
-    s->execute = true;
-    int32_t i, z;
-    for (i=0; i<STACK_PARAMETER_MAX_AMOUNT; i++) {
-        for (z=0; z<STACK_PARAMETER_MAX_LENGTH; z++) {
-            s->parameters[i][z] = 0;
-        }
-    }
-    s->next = NULL;
-}
-
-// Parse line of code
-void parse_line(char *line, int32_t line_len, int32_t linenum) {
-    // Remove trailing \n
-    if (line[--line_len] == '\n') line[line_len] = '\0';
+    // Optimize stack
+    optimize_report_t optimize_report;
+    optimize_program(optimize_level, &optimize_report);
 
-    // Pass line to parser
-    int32_t result = parse_user_command(line, line_len);
-    if (result != ERR_SUCCESS) {
-        printf("Error: %s\n", parse_error_msgs[result]);
-    } else {
-        return;
+    // Translate stack to C instead of running it
+    if (find_long_option(argc, argv, "emit-c") != NULL) {
+        emit_c_program(stdout, root, argv[argc-1]);
+        return 0;
     }
 
-parse_fail:
-    fprintf(stderr, "At line %d: %s\n", linenum, line);
-    exit(1);
-    return;
-}
-
-void parse_cleanup() {
-    // Check for unclosed if statement blocks
-    if (in_block) {
-        exit_with_error("Unclosed if statement!");
-    }
-}
-
-void stack_execute() {
-    stack_node_t *cur = root;
-    while (cur->next != NULL) {
-        // Pass stack node to handler
-        int32_t result = execute_command(&cur);
-        if (result) {
-            continue;
-        } else {
-            char error[80];
-            sprintf(error, "Failed to execute command: %s", cur->command);
-            exit_with_error(error);
+    // Start the sampling profiler
+    char *sample_hz = find_long_option(argc, argv, "sample");
+    if (sample_hz != NULL) {
+        char *output = find_long_option(argc, argv, "sample-out");
+        if (output == NULL || !output[0]) output = SAMPLE_DEFAULT_OUTPUT;
+        if (!sample_start(atoi(sample_hz), output, argv[argc-1])) {
+            fputs("[sample] Failed to start the profiler\n", stderr);
         }
     }
-}
 
-/**
- * Search for label in stack
- * @param  label name of label
- * @return pointer to stack node with label, or NULL if label isn't found
- */
-stack_node_t * stack_search_label(char *label) {
-    stack_node_t *cur = root;
-    while (cur != NULL) {
-        if (cur->command == NULL) break;
-
-        if (strcmp(cur->command, "label") == 0) {
-            char *temp = cur->parameters[0];
-            if (strcmp(temp, label) == 0) {
-                return cur;
-            }
-        }
-        cur = cur->next;
-    }
-
-    return NULL;
-}
-
-/**
- * Search for variable name in variable stack
- * @param  label name of variable
- * @return pointer to var stack node with name, or NULL if name isn't found
- */
-variable_stack_node_t * var_stack_search_label(char *label) {
-    variable_stack_node_t *cur = root_var;
-    while (cur != NULL) {
-        if (cur->name == NULL) break;
-
-        if (strcmp(cur->name, label) == 0) {
-            return cur;
-        }
-        cur = cur->next;
-    }
-
-    return NULL;
-}
-
-void set_block_execute(stack_node_t *cur, bool val) {
-    while (cur != NULL) {
-        if (cur->command == NULL) break;
-        if (strncmp(cur->command, "endif", 5) == 0) break;
-
-        cur->execute = val;
-        cur = cur->next;
-    }
-}
-
-bool eval_conditional(char *cond) {
-    // Determine sign
-    char sign = '\0';
-    if (str_index_of(cond, "=") > -1) {
-        sign = '=';
-    } else if (str_index_of(cond, ">") > -1) {
-        sign = '>';
-    } else if (str_index_of(cond, "<") > -1) {
-        sign = '<';
-    } else {
-        exit_with_error("Invalid conditional!");
-    }
-
-    // Determine parameters
-    char param_1[strlen(cond)];
-    char param_2[strlen(cond)];
-    if (split_string_delimiter(param_1, cond, " ") <= -1) {
-        exit_with_error("Invalid conditional!");
-    } else if (split_string_delimiter_rev(param_2, cond, " ") <= -1) {
-        exit_with_error("Invalid conditional!");
-    }
-
-    // Evaluate
-    if (sign == '=') {
-        if (atoi(param_1) == atoi(param_2)) return true;
-        return false;
-    } else if (sign == '>') {
-        if (atoi(param_1) > atoi(param_2)) return true;
-        return false;
-    } else if (sign == '<') {
-        if (atoi(param_1) < atoi(param_2)) return true;
-        return false;
-    } else {
-        exit_with_error("Invalid conditional!");
-    }
-}
-
-void exit_with_error(char *error) {
-    fprintf(stderr, "[error] %s\n", error);
-    exit(1);
-}
-
-char * get_data_for_var(char *var_name) {
-    variable_stack_node_t *cur = root_var;
-    while (cur != NULL) {
-        if (strcmp(cur->name, var_name) == 0) {
-            return cur->data;
-        }
-        cur = cur->next;
-    }
-    return NULL;
-}
-
-/**
- * Translates all variables prefixed with $ to "%s" to be parsed later on with
- * sprintf.
- */
-void prepare_var_string(char *str, int32_t num_vars) {
-    int32_t i;
-    for (i=0; i<num_vars; i++) {
-        int32_t cur_var_index = str_index_of(str, "$");
-        int32_t cur_var_end_index = str_index_of_skip(str, " ", cur_var_index);
-        if (cur_var_end_index <= -1) cur_var_end_index = strlen(str);
-        int32_t cur_var_length = cur_var_end_index - cur_var_index;
-        shift_string_left(str, cur_var_index, cur_var_length-2); // 2 for %s
-        str[cur_var_index] = '%';
-        str[cur_var_index+1] = 's';
-    }
-}
-
-/**
- * Parses a string containing variables (prefixed with $) into its actual value
- * Returns a full string with variables parsed (must be freed after use)
- * Returns NULL if string contains nonexistent variables
- */
-char * parse_var_string(char *str) {
-    // Get number of variables
-    int32_t num_vars = get_char_occurances(str, "$");
-    if (num_vars == 0) return NULL;
-
-    // Determine size of buffer
-    int32_t bufsize = strlen(str) + (MAX_DATA_SIZE * num_vars) - num_vars;
-    char *buf = malloc(bufsize);
-
-    // Array of var values in order
-    char var_values[num_vars][MAX_DATA_SIZE];
-    int32_t var_values_size = 0;
-
-    int32_t i;
-    for (i=0; i<num_vars; i++) {
-        int32_t cur_var_index = str_index_of_n(str, "$", i);
-        int32_t cur_var_end_index = str_index_of_skip(str, " ", cur_var_index);
-        if (cur_var_end_index <= -1) cur_var_end_index = strlen(str);
-        int32_t cur_var_length = cur_var_end_index - cur_var_index;
-        char cur_var[MAX_DATA_SIZE];
-        memset(cur_var, '\0', MAX_DATA_SIZE);
-        strncpy(cur_var, str+cur_var_index+1, cur_var_length-1);
-        // Get data for this var
-        char* cur_var_data = get_data_for_var(cur_var);
-        if (cur_var_data == NULL) return NULL;
-
-        // Store in Array
-        strcpy(var_values[var_values_size++], cur_var_data);
-    }
-
-    // Get sprintf format string
-    char formatstr[strlen(str)+1];
-    strcpy(formatstr, str);
-    prepare_var_string(formatstr, num_vars);
+    // Execute stack
+    if (timing_enabled) timing_phase(PHASE_EXECUTE);
+    if (filter_mode)
+        engine_execute_lines(engine_compile(root), filter_print);
+    else if (threaded_mode)
+        engine_execute(engine_compile(root));
+    else
+        stack_execute();
 
-    // Get final parsed string
-    sprintf(buf, formatstr, var_values);
-    return buf;
-}
+    // Reset terminal colors
+    printANSIescape("\033[0m");
 
-// wrapper around printf for ANSI escape codes
-void printANSIescape(char *code){
-    if (!monochrome_mode)
-        printf("%s", code);
+    return 0;
 }
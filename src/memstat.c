@@ -0,0 +1,218 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the counting allocator behind -M. Live allocations are
+ * kept in an open addressing table keyed by pointer, so that blocks can be
+ * handed to code that frees them with plain free() without corrupting the
+ * heap. When neither -M nor --max-mem is given, the basilc_malloc() family
+ * goes straight to the C library. The table is shared by the threads of
+ * parallel() blocks, so it is guarded by a mutex.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <memstat.h>
+
+#define MEMSTAT_TOMBSTONE ((void *) 1)
+
+bool memstat_enabled;
+
+// Total that may not be exceeded, 0 for no limit
+size_t memstat_limit;
+static void (*memstat_limit_hook)(size_t total);
+
+struct mem_stats {
+    size_t current;
+    size_t peak;
+    size_t largest;
+    uint64_t allocs;
+    uint64_t frees;
+};
+typedef struct mem_stats mem_stats_t;
+
+struct live_block {
+    void *ptr;
+    size_t size;
+    int32_t category;
+};
+typedef struct live_block live_block_t;
+
+static char *category_names[MEM_NUM_CATEGORIES] = {
+    "program nodes",
+    "compiled code",
+    "commands",
+    "variables",
+    "interpolation",
+    "source buffer",
+    "file buffers",
+};
+
+static mem_stats_t stats[MEM_NUM_CATEGORIES];
+static size_t total_current;
+static size_t total_peak;
+
+static live_block_t *blocks;
+static size_t blocks_cap;
+static size_t blocks_used; // Including tombstones
+static size_t blocks_live;
+
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t hash_ptr(void *ptr) {
+    uint64_t h = (uint64_t) (uintptr_t) ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h & (blocks_cap - 1);
+}
+
+static void blocks_insert(void *ptr, size_t size, int32_t category);
+
+static void blocks_grow() {
+    live_block_t *old = blocks;
+    size_t old_cap = blocks_cap;
+
+    // Only grow if the table is full of live blocks rather than tombstones
+    if (old_cap == 0) blocks_cap = 1024;
+    else if (blocks_live * 4 > old_cap) blocks_cap = old_cap * 2;
+    blocks = calloc(blocks_cap, sizeof(live_block_t));
+    blocks_used = 0;
+    blocks_live = 0;
+
+    size_t i;
+    for (i=0; i<old_cap; i++) {
+        if (old[i].ptr != NULL && old[i].ptr != MEMSTAT_TOMBSTONE)
+            blocks_insert(old[i].ptr, old[i].size, old[i].category);
+    }
+    free(old);
+}
+
+static void blocks_insert(void *ptr, size_t size, int32_t category) {
+    if ((blocks_used + 1) * 2 > blocks_cap) blocks_grow();
+
+    size_t i = hash_ptr(ptr);
+    while (blocks[i].ptr != NULL && blocks[i].ptr != MEMSTAT_TOMBSTONE) {
+        i = (i + 1) & (blocks_cap - 1);
+    }
+    if (blocks[i].ptr == NULL) blocks_used++;
+    blocks_live++;
+    blocks[i].ptr = ptr;
+    blocks[i].size = size;
+    blocks[i].category = category;
+}
+
+static live_block_t * blocks_find(void *ptr) {
+    if (blocks_cap == 0) return NULL;
+
+    size_t i = hash_ptr(ptr);
+    while (blocks[i].ptr != NULL) {
+        if (blocks[i].ptr == ptr) return &blocks[i];
+        i = (i + 1) & (blocks_cap - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Count an allocation. Called with blocks_lock held, so the limit hook is
+ * left to the caller: it may exit, and exit handlers free memory too.
+ * @return whether the total is now over the limit
+ */
+static bool account_alloc(void *ptr, size_t size, int32_t category) {
+    mem_stats_t *s = &stats[category];
+    s->allocs++;
+    s->current += size;
+    if (s->current > s->peak) s->peak = s->current;
+    if (size > s->largest) s->largest = size;
+
+    total_current += size;
+    if (total_current > total_peak) total_peak = total_current;
+
+    blocks_insert(ptr, size, category);
+    return memstat_limit > 0 && total_current > memstat_limit;
+}
+
+static void account_free(live_block_t *block) {
+    stats[block->category].frees++;
+    stats[block->category].current -= block->size;
+    total_current -= block->size;
+    block->ptr = MEMSTAT_TOMBSTONE;
+    blocks_live--;
+}
+
+static void memstat_report() {
+    int32_t i;
+    fflush(stdout);
+    fprintf(stderr, "\n%-16s %12s %12s %10s %10s %10s\n", "Subsystem",
+            "Peak bytes", "Final bytes", "Allocs", "Frees", "Largest");
+    for (i=0; i<MEM_NUM_CATEGORIES; i++) {
+        fprintf(stderr, "%-16s %12zu %12zu %10llu %10llu %10zu\n",
+                category_names[i], stats[i].peak, stats[i].current,
+                (unsigned long long) stats[i].allocs,
+                (unsigned long long) stats[i].frees, stats[i].largest);
+    }
+    fprintf(stderr, "%-16s %12zu %12zu\n", "total", total_peak, total_current);
+}
+
+/**
+ * Enable memory accounting. Has to be called before anything is allocated
+ * through basilc_malloc(). A report is printed to stderr at exit.
+ */
+void memstat_init() {
+    memstat_enabled = true;
+    atexit(memstat_report);
+}
+
+/**
+ * Enable memory accounting and call `hook` whenever an allocation takes the
+ * total over `limit`. Has to be called before anything is allocated.
+ */
+void memstat_set_limit(size_t limit, void (*hook)(size_t total)) {
+    memstat_enabled = true;
+    memstat_limit = limit;
+    memstat_limit_hook = hook;
+}
+
+void * memstat_malloc(size_t size, int32_t category) {
+    void *ptr = malloc(size);
+    if (ptr != NULL) {
+        pthread_mutex_lock(&blocks_lock);
+        bool over = account_alloc(ptr, size, category);
+        size_t total = total_current;
+        pthread_mutex_unlock(&blocks_lock);
+        if (over) memstat_limit_hook(total);
+    }
+    return ptr;
+}
+
+void * memstat_realloc(void *ptr, size_t size, int32_t category) {
+    pthread_mutex_lock(&blocks_lock);
+    live_block_t *block = ptr ? blocks_find(ptr) : NULL;
+    void *new_ptr = realloc(ptr, size);
+    bool over = false;
+    if (new_ptr != NULL) {
+        if (block != NULL) account_free(block);
+        over = account_alloc(new_ptr, size, category);
+    }
+    size_t total = total_current;
+    pthread_mutex_unlock(&blocks_lock);
+    if (over) memstat_limit_hook(total);
+    return new_ptr;
+}
+
+void memstat_free(void *ptr) {
+    if (ptr == NULL) return;
+
+    pthread_mutex_lock(&blocks_lock);
+    live_block_t *block = blocks_find(ptr);
+    if (block != NULL) account_free(block);
+    pthread_mutex_unlock(&blocks_lock);
+    free(ptr);
+}
@@ -0,0 +1,186 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains include(), which splices other script files into the
+ * general stack while the script is parsed.
+ *
+ * Every file is parsed at most once per process: files are identified by
+ * their real path, and including a file again, directly or through another
+ * file, does nothing. Labels of an included file are put in a namespace named
+ * after the file, so label(greet) in lib/strings.basilc is called as
+ * strings.greet from other files. goto() and call() inside the file may keep
+ * using the short name. Relative paths are resolved against the directory of
+ * the file that includes them.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <main.h>
+#include <module.h>
+#include <memstat.h>
+
+// Real paths of all files parsed so far
+static char **parsed_files;
+static int32_t num_parsed_files;
+
+// Files being parsed, the innermost last
+static char *file_stack[MODULE_MAX_DEPTH + 1];
+static int32_t file_depth;
+
+// File named by the last include(), parsed once that line is done
+static char *pending;
+
+static bool was_parsed(char *real) {
+    int32_t i;
+    for (i=0; i<num_parsed_files; i++) {
+        if (strcmp(parsed_files[i], real) == 0) return true;
+    }
+    return false;
+}
+
+static void add_parsed(char *real) {
+    parsed_files = basilc_realloc(parsed_files, sizeof(char *) *
+                                  (num_parsed_files + 1), MEM_SOURCE);
+    parsed_files[num_parsed_files++] = real;
+}
+
+/**
+ * Register the script given on the command line, which relative includes
+ * start from and which can't be included again
+ */
+void module_set_main(char *path) {
+    char *real = realpath(path, NULL);
+    if (real == NULL) return;
+    add_parsed(real);
+    file_stack[0] = real;
+    file_depth = 1;
+}
+
+/**
+ * Called by the special parse of include(). The file is parsed right after
+ * the include() node is added.
+ * @return false if the file doesn't exist or include()s are nested too deeply
+ */
+bool module_include(char *path) {
+    if (file_depth > MODULE_MAX_DEPTH) return false;
+
+    // Resolve relative paths against the including file
+    char joined[PATH_MAX];
+    if (path[0] != '/' && file_depth > 0) {
+        char *dir_end = strrchr(file_stack[file_depth-1], '/');
+        int32_t dir_len = dir_end - file_stack[file_depth-1];
+        snprintf(joined, sizeof(joined), "%.*s/%s", dir_len,
+                 file_stack[file_depth-1], path);
+        path = joined;
+    }
+
+    char *real = realpath(path, NULL);
+    if (real == NULL) return false;
+    if (was_parsed(real)) {
+        free(real);
+        return true;
+    }
+    add_parsed(real);
+    pending = real;
+    return true;
+}
+
+// Namespace of a file: its name without directory and extension
+static void file_namespace(char *real, char *ns, size_t size) {
+    char *name = strrchr(real, '/') + 1;
+    size_t len = strcspn(name, ".");
+    if (len >= size) len = size - 1;
+    memcpy(ns, name, len);
+    ns[len] = '\0';
+}
+
+// Put the labels of the nodes from `start` on into a namespace
+static void namespace_labels(stack_node_t *start, char *ns) {
+    stack_node_t *node;
+    for (node = start; node->command != NULL; node = node->next) {
+        if (strcmp(node->command, "label") != 0 &&
+            strcmp(node->command, "goto") != 0 &&
+            strcmp(node->command, "call") != 0) continue;
+
+        // Qualified names refer to other files
+        char *label = node->parameters[0];
+        if (strchr(label, MODULE_SEPARATOR) != NULL) continue;
+
+        char temp[STACK_PARAMETER_MAX_LENGTH];
+        if (snprintf(temp, sizeof(temp), "%s%c%s", ns, MODULE_SEPARATOR,
+                     label) >= (int) sizeof(temp)) {
+            char error[80];
+            snprintf(error, sizeof(error), "Label %.40s is too long at line %d",
+                     label, node->linenum);
+            exit_with_error(error);
+        }
+        strcpy(label, temp);
+    }
+}
+
+static void parse_module(char *real) {
+    FILE *fp = fopen(real, "r");
+    if (fp == NULL) {
+        char error[80];
+        snprintf(error, sizeof(error), "Failed to open included file %s",
+                 real);
+        exit_with_error(error);
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *buffer = basilc_malloc(size + 1, MEM_SOURCE);
+    size = fread(buffer, 1, size, fp);
+    buffer[size] = '\0';
+    fclose(fp);
+
+    file_stack[file_depth++] = real;
+    stack_node_t *start = current_stack;
+
+    char *line = buffer;
+    int32_t linenum = 0;
+    while (line < buffer + size) {
+        char *end = memchr(line, '\n', buffer + size - line);
+        int32_t line_len = end ? end - line + 1 : buffer + size - line;
+        char temp[line_len + 1];
+        memcpy(temp, line, line_len);
+        temp[line_len] = '\0';
+
+        // parse_line() expects room for a newline at the end
+        parse_line(temp, end ? line_len : line_len + 1, ++linenum);
+        line += line_len;
+    }
+
+    file_depth--;
+
+    // Nodes of files included by this one already know theirs
+    stack_node_t *node;
+    for (node = start; node != current_stack; node = node->next) {
+        if (node->file == NULL) node->file = real;
+    }
+
+    char ns[MAX_DATA_SIZE];
+    file_namespace(real, ns, sizeof(ns));
+    namespace_labels(start, ns);
+    basilc_free(buffer);
+}
+
+/**
+ * Parse the file named by the include() on the line that was just parsed
+ */
+void module_parse_pending() {
+    if (pending == NULL) return;
+    char *real = pending;
+    pending = NULL;
+    parse_module(real);
+}
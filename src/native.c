@@ -0,0 +1,110 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the runtime support used by C programs generated with
+ * basilc --emit-c. Generated programs are linked against libbasilc.a and
+ * call into the same handlers the interpreter uses.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <native.h>
+#include <plugin.h>
+#include <memstat.h>
+#include <stringhelpers.h>
+#include <libbasilc/libbasilc.h>
+
+/**
+ * Set up the interpreter state. Accepts the -m and -d options of basilc.
+ */
+void native_init(int32_t argc, char **argv) {
+    in_block = false;
+    monochrome_mode = false;
+    hide_debugging = false;
+
+    init_cmd_stack();
+    libbasilc_register();
+
+    int32_t c;
+    int32_t counter = 0;
+    while ((c = find_option(argc, argv, "md", &counter)) != -1)
+    switch (c) {
+        case 'm':
+            monochrome_mode = true;
+            break;
+        case 'd':
+            fclose(stderr);
+            break;
+    }
+
+    root = (stack_node_t *) basilc_malloc(sizeof(stack_node_t), MEM_NODES);
+    current_stack = root;
+    stack_node_initialize(root);
+
+    root_var = (variable_stack_node_t *)
+               basilc_malloc(sizeof(variable_stack_node_t), MEM_VARS);
+    current_var_stack = root_var;
+    var_node_initialize(root_var);
+}
+
+/**
+ * Look up a variable once and cache it in a static slot
+ * @return whether the variable exists
+ */
+bool native_bind(variable_stack_node_t **slot, char *name) {
+    if (*slot == NULL) *slot = var_stack_search_label(name);
+    return *slot != NULL;
+}
+
+/**
+ * Run a define() node, updating the variable's slot in place once it exists
+ */
+void native_define(variable_stack_node_t **slot, stack_node_t *node) {
+    if (*slot == NULL) {
+        *slot = define_var(node->parameters[0], node->parameters[1]);
+    } else {
+        redefine_var(*slot, node->parameters[1]);
+    }
+}
+
+/**
+ * Run a node through its registered handler
+ */
+void native_exec(stack_node_t *node) {
+    stack_node_t *cur = node;
+    registered_cmd_stack_t *res = cmd_stack_search_label(node->command);
+    if (res == NULL || res->handle_cmd == NULL) return;
+
+    if (!res->handle_cmd(&cur)) {
+        char error[80];
+        sprintf(error, "Failed to execute command: %s", node->command);
+        exit_with_error(error);
+    }
+    if (cur != node) {
+        char error[80];
+        sprintf(error, "Unsupported jump in native program: %s", node->command);
+        exit_with_error(error);
+    }
+}
+
+/**
+ * Load the plugin of an import() node, which the interpreter does at parse time
+ */
+void native_import(stack_node_t *node) {
+    if (!plugin_load(node->parameters[0])) exit(1);
+}
+
+int32_t native_exit() {
+    // Reset terminal colors
+    printANSIescape("\033[0m");
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the optimizer, which rewrites the general stack after
+ * parse_cleanup() and before execution. Every change is reported on stderr.
+ *
+ * -O1: folds if() conditions with only literal operands, and removes code
+ *      after an unconditional end(), goto(), return(), break() or continue()
+ *      that no label can reach
+ * -O2: also merges runs of literal say()/sayln() and removes define()s that
+ *      are overwritten before the variable is read
+ *
+ * Blocks that contain a label() are never removed or unwrapped, since a
+ * goto() could enter them. The same goes for each(), while(), parallel() and
+ * pareach() blocks, whose ends are linked at parse time.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <optimize.h>
+#include <stringhelpers.h>
+#include <memstat.h>
+#include <expr.h>
+
+static bool is_command(stack_node_t *node, char *name) {
+    return node->command != NULL && strcmp(node->command, name) == 0;
+}
+
+static bool is_literal(char *param) {
+    return strchr(param, '$') == NULL;
+}
+
+// Whether control can reach `node` from somewhere other than the node before it
+static bool is_jump_target(stack_node_t *node) {
+    return is_command(node, "label") || is_command(node, "each") ||
+           is_command(node, "endeach") || is_command(node, "while") ||
+           is_command(node, "endwhile") || is_command(node, "parallel") ||
+           is_command(node, "endparallel") || is_command(node, "pareach") ||
+           is_command(node, "endpareach");
+}
+
+static void report_change(stack_node_t *node, char *what) {
+    fprintf(stderr, "[optimizer] line %d: %s %s(%s)\n", node->linenum, what,
+            node->command, node->parameters[0]);
+}
+
+/**
+ * Unlink and free the nodes from *link up to, but not including, `end`
+ * @return number of nodes removed
+ */
+static int32_t remove_nodes(stack_node_t **link, stack_node_t *end) {
+    int32_t removed = 0;
+    while (*link != end) {
+        stack_node_t *dead = *link;
+        *link = dead->next;
+        if (current_stack == dead) current_stack = *link;
+        basilc_free(dead);
+        removed++;
+    }
+    return removed;
+}
+
+/**
+ * Find the endif() closing the if() at `node`
+ * @return the endif() node, or NULL if the block contains a label() or loop
+ */
+static stack_node_t * find_plain_endif(stack_node_t *node) {
+    stack_node_t *cur;
+    for (cur = node->next; cur->command != NULL; cur = cur->next) {
+        if (is_jump_target(cur)) return NULL;
+        if (is_command(cur, "endif")) return cur;
+    }
+    return NULL;
+}
+
+// Whether a condition was folded into a constant when it was compiled
+static bool is_foldable_conditional(stack_node_t *node) {
+    return node->data != NULL && expr_is_constant(node->data);
+}
+
+static bool fold_ifs(optimize_report_t *report) {
+    bool changed = false;
+    stack_node_t **link = &root;
+    while ((*link)->command != NULL) {
+        stack_node_t *node = *link;
+        stack_node_t *endif;
+        if (!is_command(node, "if") || !node->execute ||
+            !is_foldable_conditional(node) ||
+            (endif = find_plain_endif(node)) == NULL) {
+            link = &node->next;
+            continue;
+        }
+
+        if (eval_node_conditional(node)) {
+            // Always true: unwrap the block
+            report_change(node, "folded always true");
+            stack_node_t *cur;
+            for (cur = node->next; cur != endif; cur = cur->next) {
+                cur->execute = true;
+            }
+            remove_nodes(link, node->next);
+            stack_node_t **endif_link = link;
+            while (*endif_link != endif) endif_link = &(*endif_link)->next;
+            remove_nodes(endif_link, endif->next);
+        } else {
+            // Always false: remove the whole block
+            report_change(node, "folded always false");
+            remove_nodes(link, endif->next);
+        }
+        report->folded_ifs++;
+        changed = true;
+    }
+    return changed;
+}
+
+static bool remove_dead_code(optimize_report_t *report) {
+    bool changed = false;
+    stack_node_t *node;
+    for (node = root; node->command != NULL; node = node->next) {
+        if (!node->execute ||
+            !(is_command(node, "end") || is_command(node, "goto") ||
+              is_command(node, "return") || is_command(node, "break") ||
+              is_command(node, "continue"))) continue;
+
+        // Everything up to the next label is unreachable. Whole if() blocks
+        // are skipped over as long as no label is inside of them.
+        stack_node_t *end = node->next;
+        while (end->command != NULL && !is_jump_target(end)) {
+            if (is_command(end, "endif")) break;
+            if (is_command(end, "if")) {
+                stack_node_t *endif = find_plain_endif(end);
+                if (endif == NULL) break;
+                end = endif;
+            }
+            end = end->next;
+        }
+
+        if (end != node->next) {
+            report_change(node, "removed unreachable code after");
+            report->dead_nodes += remove_nodes(&node->next, end);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+static bool is_literal_say(stack_node_t *node) {
+    return (is_command(node, "say") || is_command(node, "sayln")) &&
+           is_literal(node->parameters[0]);
+}
+
+static bool merge_says(optimize_report_t *report) {
+    bool changed = false;
+    stack_node_t *node;
+    for (node = root; node->command != NULL; node = node->next) {
+        if (!is_literal_say(node)) continue;
+
+        stack_node_t *next;
+        while (is_literal_say(next = node->next) &&
+               next->execute == node->execute) {
+            size_t len = strlen(node->parameters[0]);
+            size_t next_len = strlen(next->parameters[0]);
+            bool newline = is_command(node, "sayln");
+            if (len + newline + next_len >= STACK_PARAMETER_MAX_LENGTH) break;
+
+            if (newline) node->parameters[0][len++] = '\n';
+            strcpy(node->parameters[0] + len, next->parameters[0]);
+            node->command = next->command;
+            report_change(next, "merged");
+            node->next = next->next;
+            basilc_free(next);
+            report->merged_says++;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Whether a node may read `var`. Unknown commands are assumed to read
+ * every variable.
+ */
+static bool may_read_var(stack_node_t *node, char *var) {
+    static char *pure_cmds[] = {
+        "say", "sayln", "tint", "tintbg", "naptime", "yolo", "define", NULL
+    };
+    int32_t i;
+    bool pure = false;
+    for (i=0; pure_cmds[i] != NULL; i++) {
+        if (is_command(node, pure_cmds[i])) pure = true;
+    }
+    if (!pure) return true;
+
+    char ref[MAX_DATA_SIZE + 1];
+    snprintf(ref, sizeof(ref), "$%s", var);
+    for (i=0; i<STACK_PARAMETER_MAX_AMOUNT; i++) {
+        if (strstr(node->parameters[i], ref) != NULL) return true;
+    }
+    return false;
+}
+
+static bool remove_dead_defines(optimize_report_t *report) {
+    bool changed = false;
+    stack_node_t **link = &root;
+    while ((*link)->command != NULL) {
+        stack_node_t *node = *link;
+        bool dead = false;
+        if (is_command(node, "define") && node->execute) {
+            // Look for a redefinition in the same straight-line run
+            stack_node_t *cur;
+            for (cur = node->next; cur->command != NULL; cur = cur->next) {
+                if (!cur->execute || may_read_var(cur, node->parameters[0]))
+                    break;
+                if (is_command(cur, "define") &&
+                    strcmp(cur->parameters[0], node->parameters[0]) == 0) {
+                    dead = true;
+                    break;
+                }
+            }
+        }
+
+        if (dead) {
+            report_change(node, "removed overwritten");
+            remove_nodes(link, node->next);
+            report->dead_defines++;
+            changed = true;
+        } else {
+            link = &node->next;
+        }
+    }
+    return changed;
+}
+
+/**
+ * Optimize the general stack at the given -O level
+ */
+void optimize_program(int32_t level, optimize_report_t *report) {
+    memset(report, 0, sizeof(optimize_report_t));
+    if (level <= 0) return;
+
+    // Each pass can expose more work for the others
+    bool changed = true;
+    while (changed) {
+        changed = fold_ifs(report);
+        changed |= remove_dead_code(report);
+        if (level >= 2) {
+            changed |= merge_says(report);
+            changed |= remove_dead_defines(report);
+        }
+    }
+
+    fprintf(stderr, "[optimizer] -O%d: %d if() folded, %d unreachable nodes "
+            "removed, %d say() merged, %d define() removed\n\n", level,
+            report->folded_ifs, report->dead_nodes, report->merged_says,
+            report->dead_defines);
+}
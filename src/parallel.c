@@ -0,0 +1,377 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the thread pool behind parallel() and pareach().
+ *
+ * Tasks are dealt round robin onto per-worker deques. A worker takes work
+ * from the back of its own deque and, once that is empty, steals from the
+ * front of the others. There is one worker per core, started on first use.
+ *
+ * A task runs its nodes with the same semantics as the threaded engine.
+ * Variables it defines are local to it, while variables that already exist
+ * are shared. Every command locks the stripes of all variable names it
+ * mentions, in ascending order, so commands on shared variables are atomic.
+ * The global variable stack itself is never changed while tasks run.
+ * Output of each task goes to its own buffer, and buffers are written out
+ * in task order once all tasks are done.
+ *
+ * A parallel block inside a task runs its tasks one after another on the
+ * same thread.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <engine.h>
+#include <parallel.h>
+#include <collection.h>
+#include <governor.h>
+#include <stringhelpers.h>
+#include <memstat.h>
+
+// Set while tasks are running on the pool
+bool parallel_active;
+
+struct worker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    task_t **deque;
+    int32_t head; // Thieves take from here
+    int32_t tail; // The owner takes from here
+    int32_t cap;
+};
+typedef struct worker worker_t;
+
+static worker_t workers[PARALLEL_MAX_WORKERS];
+static int32_t num_workers;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static int32_t queued; // Tasks waiting in deques
+static int32_t pending; // Tasks not finished yet
+
+static pthread_mutex_t var_locks[PARALLEL_LOCK_STRIPES];
+static pthread_key_t task_key;
+
+static task_t * current_task() {
+    return parallel_active ? pthread_getspecific(task_key) : NULL;
+}
+
+/**
+ * Whether the calling thread is running a task
+ */
+bool task_running() {
+    return current_task() != NULL;
+}
+
+/**
+ * Stream that commands should write their output to
+ */
+FILE * task_output() {
+    task_t *task = current_task();
+    return task != NULL ? task->out : stdout;
+}
+
+/**
+ * Find a variable defined by the running task or the tasks that ran it
+ * @return the variable, or NULL if it isn't local to the task
+ */
+variable_stack_node_t * task_find_var(char *name) {
+    task_t *task;
+    for (task = current_task(); task != NULL; task = task->parent) {
+        variable_stack_node_t *var;
+        for (var = task->vars; var != NULL; var = var->next) {
+            if (strncmp(var->name, name, MAX_DATA_SIZE-1) == 0) return var;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Declare a variable local to the running task
+ */
+variable_stack_node_t * task_new_var(char *name) {
+    task_t *task = current_task();
+    variable_stack_node_t *var = basilc_malloc(sizeof(variable_stack_node_t),
+                                               MEM_VARS);
+    var_node_initialize(var);
+    strncpy(var->name, name, MAX_DATA_SIZE-1);
+    var->name[MAX_DATA_SIZE-1] = '\0';
+    var->next = task->vars;
+    task->vars = var;
+    return var;
+}
+
+static uint64_t stripe_of(char *name, size_t len) {
+    if (len > MAX_DATA_SIZE-1) len = MAX_DATA_SIZE-1;
+    return 1ULL << (str_hash(name, len) % PARALLEL_LOCK_STRIPES);
+}
+
+// Stripes of every variable name a node could use
+static uint64_t node_stripes(stack_node_t *node) {
+    uint64_t stripes = 0;
+    int32_t i;
+    for (i=0; i<STACK_PARAMETER_MAX_AMOUNT; i++) {
+        char *param = node->parameters[i];
+        if (!param[0]) continue;
+        stripes |= stripe_of(param, strlen(param));
+
+        char *ref;
+        for (ref = strchr(param, '$'); ref != NULL; ref = strchr(ref, '$')) {
+            ref++;
+            stripes |= stripe_of(ref, strcspn(ref, " "));
+        }
+    }
+    return stripes;
+}
+
+static void lock_stripes(uint64_t stripes) {
+    int32_t i;
+    for (i=0; i<PARALLEL_LOCK_STRIPES; i++) {
+        if (stripes & (1ULL << i)) pthread_mutex_lock(&var_locks[i]);
+    }
+}
+
+static void unlock_stripes(uint64_t stripes) {
+    int32_t i;
+    for (i=PARALLEL_LOCK_STRIPES-1; i>=0; i--) {
+        if (stripes & (1ULL << i)) pthread_mutex_unlock(&var_locks[i]);
+    }
+}
+
+/**
+ * Lock a variable for the running task. Commands are already run with the
+ * variables they mention locked, except for nested parallel blocks.
+ */
+void task_lock_var(char *name) {
+    if (task_running()) lock_stripes(stripe_of(name, strlen(name)));
+}
+
+void task_unlock_var(char *name) {
+    if (task_running()) unlock_stripes(stripe_of(name, strlen(name)));
+}
+
+static bool task_contains(task_t *task, stack_node_t *node) {
+    return node->command != NULL && node->seq >= task->start->seq &&
+           node->seq < task->end->seq;
+}
+
+static void task_fail(stack_node_t *node) {
+    char error[80];
+    sprintf(error, "Failed to execute command: %s", node->command);
+    exit_with_error(error);
+}
+
+// Run the nodes of a task. Jumping out of the task ends it.
+static void task_execute(task_t *task) {
+    uint64_t insns = 0;
+    if (task->var_name != NULL) {
+        // The loop variable is always local, even if a global shares its name
+        variable_stack_node_t *var = task_new_var(task->var_name);
+        value_set(&var->value, task->var_value, strlen(task->var_value));
+    }
+
+    stack_node_t *cur = task->start;
+    while (cur != task->end && cur->command != NULL) {
+        stack_node_t *prev = cur;
+
+        // Nested parallel blocks lock for themselves, since their tasks run
+        // on this thread
+        uint64_t stripes = 0;
+        if (strcmp(cur->command, "parallel") != 0 &&
+            strcmp(cur->command, "pareach") != 0) {
+            stripes = node_stripes(cur);
+        }
+        lock_stripes(stripes);
+
+        if (strcmp(cur->command, "if") == 0) {
+            // Jump to the endif() if the condition is false, like the engine
+            if (engine_eval_if(cur)) {
+                cur = cur->next;
+            } else {
+                while (cur->command != NULL && strcmp(cur->command, "endif"))
+                    cur = cur->next;
+            }
+        } else {
+            registered_cmd_stack_t *res = cmd_stack_search_label(cur->command);
+            if (res == NULL) task_fail(cur);
+            if (res->handle_cmd != NULL && !res->handle_cmd(&cur)) task_fail(cur);
+            if (cur == prev) cur = cur->next;
+        }
+
+        unlock_stripes(stripes);
+        insns++;
+
+        if (cur != prev->next && prev->next != NULL) {
+            if (!task_contains(task, cur)) break;
+            if (governor_active) {
+                __sync_fetch_and_add(&governor_insns, insns);
+                insns = 0;
+                governor_check();
+            }
+        }
+    }
+    __sync_fetch_and_add(&governor_insns, insns);
+}
+
+// Take a task from our own deque, or steal one from another worker
+static task_t * find_task(int32_t self) {
+    int32_t i;
+    for (i=0; i<num_workers; i++) {
+        worker_t *w = &workers[(self + i) % num_workers];
+        task_t *task = NULL;
+        pthread_mutex_lock(&w->lock);
+        if (w->head < w->tail) {
+            task = (i == 0) ? w->deque[--w->tail] : w->deque[w->head++];
+        }
+        pthread_mutex_unlock(&w->lock);
+        if (task != NULL) return task;
+    }
+    return NULL;
+}
+
+static void * worker_main(void *arg) {
+    int32_t self = (int32_t) (intptr_t) arg;
+    for (;;) {
+        task_t *task = find_task(self);
+        if (task == NULL) {
+            pthread_mutex_lock(&pool_lock);
+            while (queued == 0) pthread_cond_wait(&work_cond, &pool_lock);
+            pthread_mutex_unlock(&pool_lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool_lock);
+        queued--;
+        pthread_mutex_unlock(&pool_lock);
+
+        pthread_setspecific(task_key, task);
+        task_execute(task);
+        pthread_setspecific(task_key, NULL);
+
+        pthread_mutex_lock(&pool_lock);
+        if (--pending == 0) pthread_cond_signal(&done_cond);
+        pthread_mutex_unlock(&pool_lock);
+    }
+    return NULL;
+}
+
+static void pool_start() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    num_workers = cores < 1 ? 1 : cores;
+    if (num_workers > PARALLEL_MAX_WORKERS) num_workers = PARALLEL_MAX_WORKERS;
+
+    pthread_key_create(&task_key, NULL);
+    int32_t i;
+    for (i=0; i<PARALLEL_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&var_locks[i], NULL);
+    }
+    // Workers steal from each other, so all of them are set up before any
+    // thread starts
+    for (i=0; i<num_workers; i++) {
+        worker_t *w = &workers[i];
+        pthread_mutex_init(&w->lock, NULL);
+        w->deque = NULL;
+        w->head = w->tail = w->cap = 0;
+    }
+    for (i=0; i<num_workers; i++) {
+        worker_t *w = &workers[i];
+        if (pthread_create(&w->thread, NULL, worker_main,
+                           (void *) (intptr_t) i) != 0) {
+            exit_with_error("Failed to start worker thread");
+        }
+        pthread_detach(w->thread);
+    }
+}
+
+static void deque_push(worker_t *w, task_t *task) {
+    pthread_mutex_lock(&w->lock);
+    if (w->head == w->tail) w->head = w->tail = 0;
+    if (w->tail == w->cap) {
+        w->cap = w->cap ? w->cap * 2 : 64;
+        w->deque = basilc_realloc(w->deque, sizeof(task_t *) * w->cap,
+                                  MEM_CODE);
+    }
+    w->deque[w->tail++] = task;
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void task_cleanup(task_t *task) {
+    variable_stack_node_t *var = task->vars;
+    while (var != NULL) {
+        variable_stack_node_t *next = var->next;
+        if (var->coll != NULL) collection_free(var->coll);
+        value_free(&var->value);
+        basilc_free(var);
+        var = next;
+    }
+    task->vars = NULL;
+}
+
+/**
+ * Run tasks in parallel and wait for all of them. Their output is written
+ * to stdout in task order.
+ */
+void parallel_run(task_t *tasks, int32_t num_tasks) {
+    int32_t i;
+    task_t *parent = current_task();
+    if (parent != NULL) {
+        // Nested parallel block: run the tasks right here. Other threads may
+        // be running the same block, so the tasks are copied.
+        for (i=0; i<num_tasks; i++) {
+            task_t task = tasks[i];
+            task.parent = parent;
+            task.vars = NULL;
+            task.out = parent->out;
+            pthread_setspecific(task_key, &task);
+            task_execute(&task);
+            task_cleanup(&task);
+        }
+        pthread_setspecific(task_key, parent);
+        return;
+    }
+
+    if (num_workers == 0) pool_start();
+    fflush(stdout);
+
+    for (i=0; i<num_tasks; i++) {
+        tasks[i].parent = NULL;
+        tasks[i].vars = NULL;
+        tasks[i].out = open_memstream(&tasks[i].out_buf, &tasks[i].out_len);
+        if (tasks[i].out == NULL) exit_with_error("Failed to buffer output");
+    }
+
+    parallel_active = true;
+    pthread_mutex_lock(&pool_lock);
+    pending = num_tasks;
+    pthread_mutex_unlock(&pool_lock);
+    for (i=0; i<num_tasks; i++) {
+        deque_push(&workers[i % num_workers], &tasks[i]);
+    }
+    pthread_mutex_lock(&pool_lock);
+    queued += num_tasks;
+    pthread_cond_broadcast(&work_cond);
+    while (pending > 0) pthread_cond_wait(&done_cond, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+    parallel_active = false;
+
+    for (i=0; i<num_tasks; i++) {
+        fclose(tasks[i].out);
+        fwrite(tasks[i].out_buf, 1, tasks[i].out_len, stdout);
+        free(tasks[i].out_buf);
+        task_cleanup(&tasks[i]);
+    }
+}
@@ -0,0 +1,185 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the parser for the script given on the command line.
+ *
+ * Large scripts are split into one chunk per core at line boundaries. Every
+ * chunk is lexed on its own thread into a segment of nodes, which touches no
+ * parser state. The segments are then linked onto the general stack in
+ * order, and that sequential pass does everything that depends on the lines
+ * before: the execute flag of if() blocks, special parsing such as linking
+ * blocks, and line numbers. Lines that couldn't be lexed, including commands
+ * of plugins that import() only loads in that pass, are parsed again there
+ * by parse_line(), which also reports errors exactly as before.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <main.h>
+#include <cmd.h>
+#include <parser.h>
+#include <memstat.h>
+
+static stack_node_t * new_node() {
+    stack_node_t *node = basilc_malloc(sizeof(stack_node_t), MEM_NODES);
+    stack_node_initialize(node);
+    return node;
+}
+
+// Put `src` in the place of `dst` in the general stack
+static void move_node(stack_node_t *dst, stack_node_t *src) {
+    *dst = *src;
+    basilc_free(src);
+}
+
+static void add_line(parse_segment_t *seg, registered_cmd_stack_t *cmd,
+                     char *text, int32_t len) {
+    if (seg->num_nodes == seg->max_nodes) {
+        seg->max_nodes = seg->max_nodes ? seg->max_nodes * 2 : 256;
+        seg->lines = basilc_realloc(seg->lines, sizeof(parsed_line_t) *
+                                    seg->max_nodes, MEM_NODES);
+    }
+    parsed_line_t *line = &seg->lines[seg->num_nodes++];
+    line->cmd = cmd;
+    line->text = text;
+    line->len = len;
+}
+
+// Lex every line of a chunk. Runs on a thread of its own.
+static void * lex_segment(void *arg) {
+    parse_segment_t *seg = arg;
+    seg->head = seg->tail = new_node();
+
+    char *line = seg->start;
+    while (line < seg->end) {
+        char *newline = memchr(line, '\n', seg->end - line);
+        int32_t len = newline - line;
+        seg->num_lines++;
+
+        registered_cmd_stack_t *cmd;
+        int32_t result = parse_command_node(line, len, seg->tail, &cmd);
+        if (result == ERR_SUCCESS && cmd == NULL) {
+            // Blank line or comment
+            line = newline + 1;
+            continue;
+        }
+
+        // include() splices another file in after its line, which has to
+        // happen in order as well
+        if (result != ERR_SUCCESS || strcmp(cmd->name, "include") == 0) {
+            cmd = NULL;
+        }
+        add_line(seg, cmd, line, len);
+        seg->tail->linenum = seg->num_lines;
+        seg->tail->next = new_node();
+        seg->tail = seg->tail->next;
+        line = newline + 1;
+    }
+    return NULL;
+}
+
+/**
+ * Link the nodes of a segment onto the end of the general stack and finish
+ * parsing them
+ * @param first_line number of lines before the segment
+ */
+static void stitch_segment(parse_segment_t *seg, int32_t first_line) {
+    if (seg->num_nodes == 0) {
+        basilc_free(seg->head);
+        return;
+    }
+
+    // The empty node at the end of the general stack becomes the first one
+    stack_node_t *node = current_stack;
+    move_node(node, seg->head);
+
+    int32_t i;
+    for (i=0; i<seg->num_nodes; i++) {
+        parsed_line_t *line = &seg->lines[i];
+        int32_t linenum = node->linenum + first_line;
+        current_stack = node;
+
+        if (line->cmd == NULL) {
+            stack_node_t *rest = node->next;
+            stack_node_initialize(node);
+            char temp[line->len + 1];
+            memcpy(temp, line->text, line->len);
+            temp[line->len] = '\n';
+            parse_line(temp, line->len + 1, linenum);
+
+            // The rest of the segment follows whatever the line added
+            node = current_stack;
+            move_node(node, rest);
+        } else {
+            node->linenum = linenum;
+            int32_t result = parse_finish_command(line->cmd);
+            if (result != ERR_SUCCESS) {
+                parse_fail(line->text, line->len, linenum, result);
+            }
+            node = node->next;
+        }
+    }
+    current_stack = node;
+    basilc_free(seg->lines);
+}
+
+/**
+ * Parse a script in memory onto the end of the general stack. A last line
+ * without a newline is ignored.
+ */
+void parse_source(char *source, size_t size) {
+    while (size > 0 && source[size-1] != '\n') size--;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    size_t num_segments = size / PARSE_MIN_CHUNK;
+    if (num_segments > (size_t) cores) num_segments = cores;
+    if (num_segments > PARSE_MAX_THREADS) num_segments = PARSE_MAX_THREADS;
+    if (num_segments < 1) num_segments = 1;
+
+    // Chunks end at the first newline after an equal share of the source
+    parse_segment_t segs[num_segments];
+    memset(segs, 0, sizeof(segs));
+    char *start = source;
+    size_t i;
+    for (i=0; i<num_segments; i++) {
+        char *end = source + size * (i+1) / num_segments;
+        if (end < start) end = start;
+        if (end < source + size) {
+            end = (char *) memchr(end, '\n', source + size - end) + 1;
+        }
+        segs[i].start = start;
+        segs[i].end = end;
+        start = end;
+    }
+
+    // This thread lexes the first chunk itself
+    pthread_t threads[num_segments];
+    bool started[num_segments];
+    for (i=1; i<num_segments; i++) {
+        started[i] = pthread_create(&threads[i], NULL, lex_segment,
+                                    &segs[i]) == 0;
+    }
+    lex_segment(&segs[0]);
+    for (i=1; i<num_segments; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        else lex_segment(&segs[i]);
+    }
+
+    int32_t first_line = 0;
+    for (i=0; i<num_segments; i++) {
+        stitch_segment(&segs[i], first_line);
+        first_line += segs[i].num_lines;
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains compiled patterns for match(). Patterns are POSIX
+ * extended regular expressions run by the C library's matcher. Patterns
+ * without variables are compiled once while the script is parsed, and the
+ * results of interpolated patterns are kept in a cache, so a pattern is
+ * never compiled twice in a loop.
+ *
+ * Before running the matcher, the literal text that every match has to
+ * start with is looked for with strstr(), which the C library vectorizes.
+ * Lines without it are rejected without touching the regex at all.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <pattern.h>
+#include <stringhelpers.h>
+#include <memstat.h>
+
+// Patterns compiled by pattern_get(), which are kept until exit. Slots are
+// only ever filled, so patterns can be used without holding the lock.
+static pattern_t *cache[PATTERN_CACHE_SIZE * 2];
+static int32_t cache_used;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool is_meta(char c) {
+    return c != '\0' && strchr(".[]()*+?{}|^$\\", c) != NULL;
+}
+
+static bool is_quantifier(char c) {
+    return c == '*' || c == '?' || c == '{';
+}
+
+// Find the literal prefix of a pattern
+static void find_prefix(pattern_t *pat) {
+    char *src = pat->source;
+    pat->anchored = src[0] == '^';
+    pat->prefix = basilc_malloc(strlen(src) + 1, MEM_CODE);
+    pat->prefix_len = 0;
+
+    // Any alternative could match instead
+    if (strchr(src, '|') != NULL) return;
+
+    char *cur = src + pat->anchored;
+    size_t last_start = 0;
+    while (*cur) {
+        size_t start = pat->prefix_len;
+        if (*cur == '\\' && cur[1] && is_meta(cur[1])) {
+            pat->prefix[pat->prefix_len++] = cur[1];
+            cur += 2;
+        } else if (!is_meta(*cur)) {
+            pat->prefix[pat->prefix_len++] = *cur++;
+        } else {
+            break;
+        }
+        last_start = start;
+    }
+
+    // A quantifier after the prefix may make its last character optional
+    if (is_quantifier(*cur)) pat->prefix_len = last_start;
+    pat->prefix[pat->prefix_len] = '\0';
+}
+
+/**
+ * Compile a pattern
+ * @return the pattern, or NULL if it isn't a valid regular expression
+ */
+pattern_t * pattern_compile(char *source) {
+    pattern_t *pat = basilc_malloc(sizeof(pattern_t), MEM_CODE);
+    if (regcomp(&pat->re, source, REG_EXTENDED) != 0) {
+        basilc_free(pat);
+        return NULL;
+    }
+    pat->source = basilc_malloc(strlen(source) + 1, MEM_CODE);
+    strcpy(pat->source, source);
+    pat->hash = str_hash(source, strlen(source));
+    pat->num_groups = pat->re.re_nsub + 1;
+    if (pat->num_groups > PATTERN_MAX_GROUPS)
+        pat->num_groups = PATTERN_MAX_GROUPS;
+    find_prefix(pat);
+    return pat;
+}
+
+void pattern_free(pattern_t *pat) {
+    regfree(&pat->re);
+    basilc_free(pat->source);
+    basilc_free(pat->prefix);
+    basilc_free(pat);
+}
+
+/**
+ * Get the compiled form of a pattern that is only known at runtime
+ * @param temporary set if the cache is full and the pattern has to be freed
+ *                  with pattern_free() after use
+ * @return the pattern, or NULL if it isn't a valid regular expression
+ */
+pattern_t * pattern_get(char *source, bool *temporary) {
+    uint32_t hash = str_hash(source, strlen(source));
+    uint32_t mask = PATTERN_CACHE_SIZE * 2 - 1;
+    uint32_t i;
+
+    pthread_mutex_lock(&cache_lock);
+    for (i = hash & mask; cache[i] != NULL; i = (i + 1) & mask) {
+        if (cache[i]->hash == hash && strcmp(cache[i]->source, source) == 0) {
+            pthread_mutex_unlock(&cache_lock);
+            *temporary = false;
+            return cache[i];
+        }
+    }
+
+    pattern_t *pat = pattern_compile(source);
+    *temporary = pat != NULL && cache_used == PATTERN_CACHE_SIZE;
+    if (pat != NULL && !*temporary) {
+        cache[i] = pat;
+        cache_used++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return pat;
+}
+
+/**
+ * Match a pattern against text
+ * @param groups room for PATTERN_MAX_GROUPS groups, the first one being the
+ *               whole match
+ * @return number of groups filled in, or 0 if the text doesn't match
+ */
+int32_t pattern_match(pattern_t *pat, char *text, pattern_group_t *groups) {
+    // Reject text without the literal prefix up front
+    if (pat->prefix_len > 0) {
+        if (pat->anchored) {
+            if (strncmp(text, pat->prefix, pat->prefix_len) != 0) return 0;
+        } else if (pat->prefix_len == 1) {
+            if (strchr(text, pat->prefix[0]) == NULL) return 0;
+        } else if (strstr(text, pat->prefix) == NULL) {
+            return 0;
+        }
+    }
+
+    regmatch_t matches[PATTERN_MAX_GROUPS];
+    if (regexec(&pat->re, text, pat->num_groups, matches, 0) != 0) return 0;
+
+    int32_t i;
+    for (i=0; i<pat->num_groups; i++) {
+        groups[i].start = matches[i].rm_so;
+        groups[i].end = matches[i].rm_eo;
+    }
+    return pat->num_groups;
+}
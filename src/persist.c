@@ -0,0 +1,225 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the state file behind persist() and checkpoint(). The
+ * file is a fixed-size hash table of slots that is mapped into memory on the
+ * first persist(), so loading state takes no parsing, and a variable is
+ * found by hashing its name.
+ *
+ * Persisted variables are written back in place by checkpoint() and at
+ * exit, followed by msync(). Each slot holds two copies of its value, and
+ * a write always goes to the older one, with a checksum covering its
+ * sequence number, length and text. A copy torn by a crash fails its
+ * checksum, so the previous value is used instead.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <main.h>
+#include <persist.h>
+#include <stringhelpers.h>
+#include <memstat.h>
+
+char *persist_path;
+
+static persist_header_t *header;
+static persist_slot_t *slots;
+static size_t map_size;
+static pthread_mutex_t persist_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Slots of the variables bound by persist()
+static persist_slot_t **bound;
+static int32_t num_bound;
+
+static uint32_t copy_checksum(persist_copy_t *copy) {
+    uint32_t hash = str_hash((char *) &copy->seq, sizeof(copy->seq));
+    hash ^= str_hash((char *) &copy->len, sizeof(copy->len));
+    if (copy->len <= PERSIST_VALUE_MAX)
+        hash ^= str_hash(copy->data, copy->len) * 31;
+    return hash;
+}
+
+static bool copy_valid(persist_copy_t *copy) {
+    return copy->len <= PERSIST_VALUE_MAX &&
+           copy->checksum == copy_checksum(copy);
+}
+
+/**
+ * The current copy of a slot
+ * @return the copy, or NULL if the slot holds no value yet
+ */
+static persist_copy_t * current_copy(persist_slot_t *slot) {
+    persist_copy_t *a = &slot->copies[0];
+    persist_copy_t *b = &slot->copies[1];
+    bool a_valid = copy_valid(a) && a->seq > 0;
+    bool b_valid = copy_valid(b) && b->seq > 0;
+    if (a_valid && (!b_valid || a->seq > b->seq)) return a;
+    if (b_valid) return b;
+    return NULL;
+}
+
+static void persist_at_exit() {
+    persist_checkpoint();
+}
+
+static bool persist_open() {
+    int fd = open(persist_path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+
+    map_size = sizeof(persist_header_t) + sizeof(persist_slot_t) * PERSIST_SLOTS;
+    struct stat st;
+    bool fresh = fstat(fd, &st) == 0 && st.st_size == 0;
+    if (fresh && ftruncate(fd, map_size) != 0) {
+        close(fd);
+        return false;
+    }
+    if (!fresh && (size_t) st.st_size != map_size) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    header = map;
+    slots = (persist_slot_t *) (header + 1);
+    if (fresh) {
+        memcpy(header->magic, PERSIST_MAGIC, sizeof(header->magic));
+        header->version = PERSIST_VERSION;
+        header->num_slots = PERSIST_SLOTS;
+        header->value_max = PERSIST_VALUE_MAX;
+        msync(map, map_size, MS_SYNC);
+    } else if (memcmp(header->magic, PERSIST_MAGIC, sizeof(header->magic)) ||
+               header->version != PERSIST_VERSION ||
+               header->num_slots != PERSIST_SLOTS ||
+               header->value_max != PERSIST_VALUE_MAX) {
+        munmap(map, map_size);
+        header = NULL;
+        return false;
+    }
+
+    atexit(persist_at_exit);
+    return true;
+}
+
+/**
+ * Find the slot of a variable, claiming a free one if it has none
+ * @return the slot, or NULL if the file is full
+ */
+static persist_slot_t * find_slot(char *name) {
+    char key[MAX_DATA_SIZE];
+    strncpy(key, name, MAX_DATA_SIZE-1);
+    key[MAX_DATA_SIZE-1] = '\0';
+
+    uint32_t mask = PERSIST_SLOTS - 1;
+    uint32_t start = str_hash(key, strlen(key)) & mask;
+    uint32_t i = start;
+    do {
+        persist_slot_t *slot = &slots[i];
+        if (slot->name[0] == '\0') {
+            memset(slot, 0, sizeof(persist_slot_t));
+            strcpy(slot->name, key);
+            return slot;
+        }
+        if (strcmp(slot->name, key) == 0) return slot;
+        i = (i + 1) & mask;
+    } while (i != start);
+    return NULL;
+}
+
+/**
+ * Bind a variable to the state file, loading its stored value if it has
+ * one. The state file is opened on the first call.
+ * @return false if the state file can't be used
+ */
+bool persist_bind(char *name) {
+    pthread_mutex_lock(&persist_lock);
+    if (header == NULL && !persist_open()) {
+        pthread_mutex_unlock(&persist_lock);
+        return false;
+    }
+
+    persist_slot_t *slot = find_slot(name);
+    if (slot == NULL) {
+        pthread_mutex_unlock(&persist_lock);
+        return false;
+    }
+
+    int32_t i;
+    bool known = false;
+    for (i=0; i<num_bound; i++) {
+        if (bound[i] == slot) known = true;
+    }
+    if (!known) {
+        bound = basilc_realloc(bound, sizeof(persist_slot_t *) *
+                               (num_bound + 1), MEM_VARS);
+        bound[num_bound++] = slot;
+    }
+
+    // The stored value replaces whatever the variable held
+    persist_copy_t *copy = current_copy(slot);
+    if (copy != NULL) {
+        variable_stack_node_t *var = define_var(name, "");
+        value_set(&var->value, copy->data, copy->len);
+    } else if (var_stack_search_label(name) == NULL) {
+        define_var(name, "");
+    }
+    pthread_mutex_unlock(&persist_lock);
+    return true;
+}
+
+/**
+ * Write the values of all bound variables to the state file and flush it
+ * to disk
+ * @return false if a value is too long to be persisted
+ */
+bool persist_checkpoint() {
+    bool ok = true;
+    bool changed = false;
+    int32_t i;
+
+    pthread_mutex_lock(&persist_lock);
+    for (i=0; i<num_bound; i++) {
+        persist_slot_t *slot = bound[i];
+        variable_stack_node_t *var = var_stack_search_label(slot->name);
+        if (var == NULL) continue;
+
+        char *text = value_flatten(&var->value);
+        size_t len = var->value.len;
+        if (len > PERSIST_VALUE_MAX) {
+            ok = false;
+            continue;
+        }
+
+        // Only write values that changed
+        persist_copy_t *cur = current_copy(slot);
+        if (cur != NULL && cur->len == len && memcmp(cur->data, text, len) == 0)
+            continue;
+
+        persist_copy_t *old = (cur == &slot->copies[0]) ? &slot->copies[1] :
+                                                          &slot->copies[0];
+        old->seq = cur != NULL ? cur->seq + 1 : 1;
+        old->len = len;
+        memcpy(old->data, text, len);
+        old->checksum = copy_checksum(old);
+        changed = true;
+    }
+    if (changed) msync(header, map_size, MS_SYNC);
+    pthread_mutex_unlock(&persist_lock);
+    return ok;
+}
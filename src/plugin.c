@@ -0,0 +1,85 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the loader for native extensions. Plugins are loaded
+ * with dlopen() while parsing, and their commands are added to the
+ * registered_cmd_stack like the ones from libbasilc.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __unix__
+#include <dlfcn.h>
+#endif
+
+#include <main.h>
+#include <cmd.h>
+#include <plugin.h>
+#include <memstat.h>
+
+static void host_set_var(char *name, char *data) {
+    define_var(name, data);
+}
+
+static void host_free_var_string(char *str) {
+    basilc_free(str);
+}
+
+static const basilc_host_api_t host_api = {
+    .abi_version = BASILC_PLUGIN_ABI_VERSION,
+    .get_var = get_data_for_var,
+    .set_var = host_set_var,
+    .parse_var_string = parse_var_string,
+    .free_var_string = host_free_var_string,
+    .exit_with_error = exit_with_error,
+};
+
+/**
+ * Load a plugin and register its commands
+ * @return whether the plugin was loaded
+ */
+bool plugin_load(char *path) {
+#ifdef __unix__
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        fprintf(stderr, "[error] %s\n", dlerror());
+        return false;
+    }
+
+    basilc_plugin_t *plugin = dlsym(handle, "basilc_plugin");
+    if (plugin == NULL) {
+        fprintf(stderr, "[error] %s is not a BasilC plugin\n", path);
+        dlclose(handle);
+        return false;
+    }
+
+    if (plugin->abi_version != BASILC_PLUGIN_ABI_VERSION ||
+        plugin->node_size != sizeof(stack_node_t)) {
+        fprintf(stderr, "[error] Plugin %s was built for a different "
+                "interpreter version\n", path);
+        dlclose(handle);
+        return false;
+    }
+
+    if (plugin->init != NULL && !plugin->init(&host_api)) {
+        fprintf(stderr, "[error] Plugin %s failed to initialize\n", path);
+        dlclose(handle);
+        return false;
+    }
+
+    int32_t i;
+    for (i=0; i<plugin->num_commands; i++) {
+        register_cmd(&plugin->commands[i]);
+    }
+    return true;
+#else
+    fprintf(stderr, "[error] Plugins are not supported on this platform\n");
+    return false;
+#endif
+}
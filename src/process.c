@@ -0,0 +1,152 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the process runner behind capture(). Commands are split
+ * into words here and started with posix_spawnp(), without a shell, and
+ * their standard output is read through a pipe as it is produced. A command
+ * that writes more than capture_max bytes or runs longer than
+ * capture_timeout_ms is killed.
+ *
+ * Words are separated by spaces. Single or double quotes group words with
+ * spaces, and a backslash escapes the next character.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <process.h>
+#include <timing.h>
+#include <memstat.h>
+
+extern char **environ;
+
+size_t capture_max = CAPTURE_DEFAULT_MAX;
+uint32_t capture_timeout_ms = CAPTURE_DEFAULT_TIMEOUT_MS;
+
+/**
+ * Split a command into words in place
+ * @return number of words, or -1 if there are too many
+ */
+static int32_t split_words(char *cmd, char **argv) {
+    int32_t argc = 0;
+    char *in = cmd;
+    char *out = cmd;
+    while (*in) {
+        while (*in == ' ' || *in == '\t') in++;
+        if (!*in) break;
+        if (argc == CAPTURE_MAX_ARGS) return -1;
+
+        argv[argc++] = out;
+        char quote = '\0';
+        while (*in && (quote || (*in != ' ' && *in != '\t'))) {
+            if (*in == '\\' && in[1]) {
+                *out++ = in[1];
+                in += 2;
+            } else if (quote && *in == quote) {
+                quote = '\0';
+                in++;
+            } else if (!quote && (*in == '"' || *in == '\'')) {
+                quote = *in++;
+            } else {
+                *out++ = *in++;
+            }
+        }
+        if (*in) in++;
+        *out++ = '\0';
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/**
+ * Run a command and hand its output to `sink`
+ * @param status set to the exit status of the command, 128 plus the signal
+ *               if it was killed, or one of the CAPTURE_STATUS_* values
+ * @return false if the command couldn't be started
+ */
+bool process_capture(char *cmd, capture_sink_t sink, void *ctx,
+                     int32_t *status) {
+    char words[strlen(cmd) + 1];
+    strcpy(words, cmd);
+    char *argv[CAPTURE_MAX_ARGS + 1];
+    if (split_words(words, argv) <= 0) return false;
+
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (err != 0) {
+        close(fds[0]);
+        *status = CAPTURE_STATUS_NOT_FOUND;
+        return err == ENOENT;
+    }
+
+    uint64_t deadline = timing_now() + (uint64_t) capture_timeout_ms * 1000000;
+    size_t total = 0;
+    bool timed_out = false;
+    bool at_end = false;
+    char *buf = basilc_malloc(CAPTURE_READ_SIZE, MEM_INTERP);
+    for (;;) {
+        uint64_t now = timing_now();
+        if (now >= deadline) {
+            timed_out = true;
+            break;
+        }
+        struct pollfd pfd = { .fd = fds[0], .events = POLLIN };
+        int ready = poll(&pfd, 1, (deadline - now) / 1000000 + 1);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        ssize_t n = read(fds[0], buf, CAPTURE_READ_SIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            at_end = n == 0;
+            break;
+        }
+
+        // Keep what fits under the cap, and stop the command
+        if (total + n > capture_max) n = capture_max - total;
+        sink(buf, n, ctx);
+        total += n;
+        if (total == capture_max) break;
+    }
+    basilc_free(buf);
+    close(fds[0]);
+
+    // A command that was cut short is killed, otherwise it closed its
+    // output and is about to exit
+    int wstatus;
+    if (!at_end) kill(pid, SIGKILL);
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR);
+    if (timed_out) {
+        *status = CAPTURE_STATUS_TIMEOUT;
+    } else if (WIFEXITED(wstatus)) {
+        *status = WEXITSTATUS(wstatus);
+    } else {
+        *status = 128 + WTERMSIG(wstatus);
+    }
+    return true;
+}
@@ -0,0 +1,504 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the interpreter state and the functions that parse and
+ * run the general stack. Everything but main() lives here so that the
+ * interpreter can also be linked into other programs as libbasilc.a
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <stringhelpers.h>
+#include <cmd.h>
+#include <memstat.h>
+#include <collection.h>
+#include <sample.h>
+#include <governor.h>
+#include <parallel.h>
+#include <module.h>
+#include <expr.h>
+
+stack_node_t *root;
+stack_node_t *current_stack;
+
+variable_stack_node_t *root_var;
+variable_stack_node_t *current_var_stack;
+
+bool in_block;
+bool monochrome_mode;
+bool hide_debugging;
+
+// Blocks opened at parse time that haven't been closed yet
+static stack_node_t *open_blocks[MAX_BLOCK_DEPTH];
+static int32_t num_open_blocks;
+
+// Hash index of the variable stack, so lookups don't scan the whole list
+static variable_stack_node_t **var_index;
+static uint32_t var_index_size; // Power of two
+static uint32_t num_vars;
+
+// Variables defined before the last reset_vars() are treated as missing
+static uint32_t var_generation;
+
+// Intialize an empty stack node
+void stack_node_initialize(stack_node_t *s) {
+    s->command = NULL;
+    s->execute = true;
+    memset(s->parameters, 0, sizeof(s->parameters));
+    s->linenum = 0;
+    s->file = NULL;
+    s->seq = 0; // Set to the position in the stack by parse_cleanup()
+    s->pc = -1;
+    s->block = NULL;
+    s->data = NULL;
+    s->next = NULL;
+}
+
+// Parse line of code
+void parse_line(char *line, int32_t line_len, int32_t linenum) {
+    // Remove trailing \n
+    if (line[--line_len] == '\n') line[line_len] = '\0';
+
+    // Pass line to parser
+    current_stack->linenum = linenum;
+    int32_t result = parse_user_command(line, line_len);
+    if (result != ERR_SUCCESS) parse_fail(line, line_len, linenum, result);
+
+    // Files named by include() go right after it
+    module_parse_pending();
+}
+
+// Report a line that failed to parse and exit
+void parse_fail(char *line, int32_t line_len, int32_t linenum, int32_t result) {
+    printf("Error: %s\n", parse_error_msgs[result]);
+    if (parse_error_col > 0)
+        fprintf(stderr, "At line %d, column %d: %.*s\n", linenum,
+                parse_error_col, line_len, line);
+    else
+        fprintf(stderr, "At line %d: %.*s\n", linenum, line_len, line);
+    exit(1);
+}
+
+void parse_cleanup() {
+    // Check for unclosed if statement blocks
+    if (in_block) {
+        exit_with_error("Unclosed if statement!");
+    }
+
+    // Check for unclosed each() and similar blocks
+    if (num_open_blocks > 0) {
+        stack_node_t *node = open_blocks[num_open_blocks-1];
+        char error[80];
+        sprintf(error, "Unclosed %s() block at line %d!", node->command,
+                node->linenum);
+        exit_with_error(error);
+    }
+
+    // Number the nodes in order. Included files are spliced in where they
+    // are included, so line numbers don't say where a node is.
+    stack_node_t *node;
+    int32_t seq = 0;
+    for (node = root; node != NULL; node = node->next) node->seq = seq++;
+
+    // Resolve the labels of call()s, which may come after them
+    for (node = root; node->command != NULL; node = node->next) {
+        if (strcmp(node->command, "call") != 0) continue;
+        node->block = stack_search_label(node->parameters[0]);
+        if (node->block == NULL) {
+            char error[80];
+            sprintf(error, "Unknown label in call() at line %d!",
+                    node->linenum);
+            exit_with_error(error);
+        }
+    }
+}
+
+/**
+ * Open a block at parse time, to be closed by block_close()
+ * @return false if blocks are nested too deeply
+ */
+bool block_open(stack_node_t *node) {
+    if (num_open_blocks == MAX_BLOCK_DEPTH) return false;
+    open_blocks[num_open_blocks++] = node;
+    return true;
+}
+
+/**
+ * Close the innermost open block, which has to be opened by the command
+ * `opener`, and link both ends of it through their block fields
+ * @return the node that opened the block, or NULL if it doesn't match
+ */
+stack_node_t * block_close(stack_node_t *node, char *opener) {
+    if (num_open_blocks == 0) {
+        printf("%s() without a %s() block!\n", node->command, opener);
+        return NULL;
+    }
+    stack_node_t *start = open_blocks[num_open_blocks-1];
+    if (strcmp(start->command, opener) != 0) {
+        printf("%s() can't close the %s() block at line %d!\n",
+               node->command, start->command, start->linenum);
+        return NULL;
+    }
+
+    num_open_blocks--;
+    start->block = node;
+    node->block = start;
+    return start;
+}
+
+/**
+ * Whether a block opened by the command `opener`, or any block if it is
+ * NULL, is open at parse time
+ */
+bool block_inside(char *opener) {
+    int32_t i;
+    for (i=0; i<num_open_blocks; i++) {
+        if (opener == NULL || strcmp(open_blocks[i]->command, opener) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Find the innermost block opened by the command `opener` that is open at
+ * parse time
+ * @return its depth, 1 for the outermost block, or 0 if there is none
+ */
+int32_t block_depth(char *opener) {
+    int32_t i;
+    for (i=num_open_blocks-1; i>=0; i--) {
+        if (strcmp(open_blocks[i]->command, opener) == 0) return i+1;
+    }
+    return 0;
+}
+
+/**
+ * Get the node that opened the block at the given depth, see block_depth()
+ */
+stack_node_t * block_at(int32_t depth) {
+    return open_blocks[depth-1];
+}
+
+void stack_execute() {
+    stack_node_t *cur = root;
+    while (cur->next != NULL) {
+        // Pass stack node to handler
+        sample_node = cur;
+        stack_node_t *prev = cur;
+        int32_t result = execute_command(&cur);
+        if (result) {
+            // Resource limits are checked whenever a command jumps
+            governor_insns++;
+            if (governor_active && cur != prev->next) governor_check();
+            continue;
+        } else {
+            char error[80];
+            sprintf(error, "Failed to execute command: %s", cur->command);
+            exit_with_error(error);
+        }
+    }
+}
+
+/**
+ * Search for label in stack
+ * @param  label name of label
+ * @return pointer to stack node with label, or NULL if label isn't found
+ */
+stack_node_t * stack_search_label(char *label) {
+    stack_node_t *cur = root;
+    while (cur != NULL) {
+        if (cur->command == NULL) break;
+
+        if (strcmp(cur->command, "label") == 0) {
+            char *temp = cur->parameters[0];
+            if (strcmp(temp, label) == 0) {
+                return cur;
+            }
+        }
+        cur = cur->next;
+    }
+
+    return NULL;
+}
+
+// Intialize an empty variable stack node
+void var_node_initialize(variable_stack_node_t *v) {
+    v->name[0] = '\0';
+    value_init(&v->value);
+    v->coll = NULL;
+    v->generation = 0;
+    v->next = NULL;
+}
+
+// Slot for `name` in the variable index, which is either empty or holds it
+static variable_stack_node_t ** var_index_slot(char *name) {
+    uint32_t mask = var_index_size - 1;
+    uint32_t i = str_hash(name, strlen(name)) & mask;
+    while (var_index[i] != NULL && strcmp(var_index[i]->name, name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &var_index[i];
+}
+
+static void var_index_insert(variable_stack_node_t *var) {
+    // Keep the index at most half full
+    if ((num_vars + 1) * 2 > var_index_size) {
+        variable_stack_node_t **old = var_index;
+        uint32_t old_size = var_index_size;
+        var_index_size = old_size ? old_size * 2 : 64;
+        var_index = basilc_malloc(sizeof(variable_stack_node_t *) *
+                                  var_index_size, MEM_VARS);
+        memset(var_index, 0, sizeof(variable_stack_node_t *) * var_index_size);
+
+        uint32_t i;
+        for (i=0; i<old_size; i++) {
+            if (old[i] != NULL) *var_index_slot(old[i]->name) = old[i];
+        }
+        basilc_free(old);
+    }
+    *var_index_slot(var->name) = var;
+    num_vars++;
+}
+
+// Find a variable in the index, whether or not it was reset
+static variable_stack_node_t * find_var(char *label) {
+    if (var_index == NULL) return NULL;
+
+    // Names are stored truncated
+    char name[MAX_DATA_SIZE];
+    strncpy(name, label, MAX_DATA_SIZE-1);
+    name[MAX_DATA_SIZE-1] = '\0';
+    return *var_index_slot(name);
+}
+
+/**
+ * Search for variable name in variable stack
+ * @param  label name of variable
+ * @return pointer to var stack node with name, or NULL if name isn't found
+ */
+variable_stack_node_t * var_stack_search_label(char *label) {
+    // Variables local to a parallel task come first
+    if (parallel_active) {
+        variable_stack_node_t *local = task_find_var(label);
+        if (local != NULL) return local;
+    }
+
+    variable_stack_node_t *var = find_var(label);
+    if (var == NULL || var->generation != var_generation) return NULL;
+    return var;
+}
+
+/**
+ * Set an existing variable, which turns a collection back into a string
+ */
+void redefine_var(variable_stack_node_t *var, char *data) {
+    if (var->coll != NULL) {
+        collection_free(var->coll);
+        var->coll = NULL;
+    }
+    value_set(&var->value, data, strlen(data));
+    var->generation = var_generation;
+}
+
+/**
+ * Set a variable, declaring it if it doesn't exist yet
+ * @return pointer to the variable's node
+ */
+variable_stack_node_t * define_var(char *name, char *data) {
+    // Check if variable already exists, or existed before a reset
+    variable_stack_node_t *var;
+    if (parallel_active && task_running()) {
+        // Tasks can change existing variables, but new ones are local
+        var = var_stack_search_label(name);
+        if (var == NULL) var = task_new_var(name);
+    } else {
+        var = find_var(name);
+    }
+    if (var != NULL) {
+        redefine_var(var, data);
+        return var;
+    }
+
+    // Add to variable stack
+    var = current_var_stack;
+    strncpy(var->name, name, MAX_DATA_SIZE-1);
+    var->name[MAX_DATA_SIZE-1] = '\0';
+    value_set(&var->value, data, strlen(data));
+    var->generation = var_generation;
+    var_index_insert(var);
+
+    // Advance variable stack
+    current_var_stack->next = (variable_stack_node_t *)
+                              basilc_malloc(sizeof(variable_stack_node_t),
+                                            MEM_VARS);
+    current_var_stack = current_var_stack->next;
+    var_node_initialize(current_var_stack);
+
+    return var;
+}
+
+/**
+ * Remove a single variable. Its node is reused if it is defined again.
+ */
+void undefine_var(variable_stack_node_t *var) {
+    if (var->coll != NULL) {
+        collection_free(var->coll);
+        var->coll = NULL;
+    }
+    value_set(&var->value, "", 0);
+    var->generation = var_generation - 1;
+}
+
+/**
+ * Forget all variables in O(1). Their nodes and buffers are reused when the
+ * same names are defined again.
+ */
+void reset_vars() {
+    var_generation++;
+}
+
+void set_block_execute(stack_node_t *cur, bool val) {
+    while (cur != NULL) {
+        if (cur->command == NULL) break;
+        if (strncmp(cur->command, "endif", 5) == 0) break;
+
+        cur->execute = val;
+        cur = cur->next;
+    }
+}
+
+/**
+ * Evaluate a condition given as text, see expr.c
+ */
+bool eval_conditional(char *cond) {
+    char *error;
+    expr_t *expr = expr_compile(cond, &error);
+    if (expr == NULL) exit_with_error("Invalid conditional!");
+
+    expr_value_t value;
+    expr_eval(expr, &value);
+    bool result = expr_truthy(&value);
+    basilc_free(expr);
+    return result;
+}
+
+// Evaluate the condition of an if() or while() node
+bool eval_node_conditional(stack_node_t *node) {
+    expr_value_t value;
+    expr_eval(expr_of_node(node, 0), &value);
+    return expr_truthy(&value);
+}
+
+void exit_with_error(char *error) {
+    fprintf(stderr, "[error] %s\n", error);
+    exit(1);
+}
+
+char * get_data_for_var(char *var_name) {
+    variable_stack_node_t *var = var_stack_search_label(var_name);
+    if (var == NULL) return NULL;
+    return value_flatten(&var->value);
+}
+
+/**
+ * Find the next variable (prefixed with $) in a string. A variable name ends
+ * at the next space.
+ * @return pointer to the $, or NULL if there are no more variables
+ */
+static char * next_var_ref(char *str, char *name) {
+    char *start = strchr(str, '$');
+    if (start == NULL) return NULL;
+
+    int32_t len = strcspn(start+1, " ");
+    if (len > MAX_DATA_SIZE-1) len = MAX_DATA_SIZE-1;
+    memcpy(name, start+1, len);
+    name[len] = '\0';
+    return start;
+}
+
+/**
+ * Look up every variable in a string
+ * @return false if any of them don't exist
+ */
+static bool resolve_var_refs(char *str, variable_stack_node_t **vars) {
+    char name[MAX_DATA_SIZE];
+    int32_t i = 0;
+    while ((str = next_var_ref(str, name)) != NULL) {
+        if ((vars[i++] = var_stack_search_label(name)) == NULL) return false;
+        str += strcspn(str, " ");
+    }
+    return true;
+}
+
+/**
+ * Parses a string containing variables (prefixed with $) into its actual value
+ * Returns a full string with variables parsed (must be freed after use)
+ * Returns NULL if string contains nonexistent variables
+ */
+char * parse_var_string(char *str) {
+    // Get number of variables
+    int32_t num_vars = get_char_occurances(str, "$");
+    if (num_vars == 0) return NULL;
+
+    variable_stack_node_t *vars[num_vars];
+    if (!resolve_var_refs(str, vars)) return NULL;
+
+    // Determine size of buffer
+    size_t bufsize = strlen(str) + 1;
+    int32_t i;
+    for (i=0; i<num_vars; i++) {
+        bufsize += vars[i]->value.len;
+    }
+    char *buf = basilc_malloc(bufsize, MEM_INTERP);
+
+    // Copy text and variable values in order
+    char name[MAX_DATA_SIZE];
+    char *cur = str;
+    char *ref;
+    size_t pos = 0;
+    for (i=0; (ref = next_var_ref(cur, name)) != NULL; i++) {
+        memcpy(buf+pos, cur, ref-cur);
+        pos += ref-cur;
+        pos += value_copy(&vars[i]->value, buf+pos);
+        cur = ref + strcspn(ref, " ");
+    }
+    strcpy(buf+pos, cur);
+    return buf;
+}
+
+/**
+ * Print a string containing variables (prefixed with $) without building it
+ * in memory first
+ * Returns false, without printing anything, if string contains nonexistent
+ * variables
+ */
+bool print_var_string(char *str, FILE *out) {
+    int32_t num_vars = get_char_occurances(str, "$");
+    variable_stack_node_t *vars[num_vars + 1];
+    if (!resolve_var_refs(str, vars)) return false;
+
+    char name[MAX_DATA_SIZE];
+    char *ref;
+    int32_t i;
+    for (i=0; (ref = next_var_ref(str, name)) != NULL; i++) {
+        fwrite(str, 1, ref-str, out);
+        value_write(&vars[i]->value, out);
+        str = ref + strcspn(ref, " ");
+    }
+    fputs(str, out);
+    return true;
+}
+
+// wrapper around printf for ANSI escape codes
+void printANSIescape(char *code){
+    if (!monochrome_mode)
+        printf("%s", code);
+}
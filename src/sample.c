@@ -0,0 +1,151 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the sampling profiler used with --sample. SIGPROF is
+ * delivered at a fixed rate of CPU time by setitimer(ITIMER_PROF), and the
+ * handler counts a sample for sample_node, which both execution loops update
+ * before every command. The handler only reads that pointer and increments a
+ * preallocated counter, so it is async-signal-safe and the cost while running
+ * is one store per command.
+ *
+ * At exit the counts are written as folded stacks (script;label;line), with
+ * lines of include()d files named after their file, the input format of
+ * flamegraph.pl and speedscope. Time spent in loops compiled by the JIT is
+ * counted for the goto() that closes the loop.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <main.h>
+#include <sample.h>
+#include <memstat.h>
+
+#ifdef SAMPLE_SUPPORTED
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+stack_node_t * volatile sample_node;
+
+// Samples of every node by its seq plus one. Index 0 counts samples outside
+// of the script.
+static uint64_t *node_samples;
+static int32_t num_nodes;
+static char *sample_output;
+static char *sample_script;
+
+#ifdef SAMPLE_SUPPORTED
+
+static void sample_handler(int sig) {
+    (void) sig;
+    stack_node_t *node = sample_node;
+    int32_t index = node != NULL ? node->seq + 1 : 0;
+    if (index < 0 || index > num_nodes) index = 0;
+    node_samples[index]++;
+}
+
+// Write a frame name, leaving out the characters folded stacks reserve
+static void write_frame(FILE *out, char *name) {
+    for (; *name; name++) {
+        fputc(*name == ';' || *name == '\n' ? '_' : *name, out);
+    }
+}
+
+static void sample_finish() {
+    // Stop sampling before reading the counters
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_IGN);
+
+    FILE *out = fopen(sample_output, "w");
+    if (out == NULL) {
+        perror("[sample] Error");
+        return;
+    }
+
+    // Lines are attributed to the label above them
+    uint64_t total = node_samples[0];
+    char *region = "main";
+    stack_node_t *cur;
+    for (cur = root; cur != NULL && cur->command != NULL; cur = cur->next) {
+        if (strcmp(cur->command, "label") == 0) region = cur->parameters[0];
+
+        int32_t index = cur->seq + 1;
+        if (index <= 0 || index > num_nodes || node_samples[index] == 0)
+            continue;
+        write_frame(out, sample_script);
+        fputc(';', out);
+        write_frame(out, region);
+        fprintf(out, ";line %d", cur->linenum);
+        if (cur->file != NULL) {
+            fputs(" of ", out);
+            write_frame(out, cur->file);
+        }
+        fprintf(out, " %s() %llu\n", cur->command,
+                (unsigned long long) node_samples[index]);
+        total += node_samples[index];
+        node_samples[index] = 0;
+    }
+    if (node_samples[0] > 0) {
+        write_frame(out, sample_script);
+        fprintf(out, ";[interpreter] %llu\n",
+                (unsigned long long) node_samples[0]);
+    }
+    fclose(out);
+
+    fprintf(stderr, "[sample] %llu samples written to %s\n",
+            (unsigned long long) total, sample_output);
+}
+
+/**
+ * Start sampling the parsed program `hz` times per second of CPU time. The
+ * folded stacks are written to `output` at exit.
+ * @return false if sampling couldn't be started
+ */
+bool sample_start(int32_t hz, char *output, char *script_name) {
+    stack_node_t *cur;
+    num_nodes = 0;
+    for (cur = root; cur != NULL && cur->command != NULL; cur = cur->next) {
+        if (cur->seq + 1 > num_nodes) num_nodes = cur->seq + 1;
+    }
+    node_samples = basilc_malloc(sizeof(uint64_t) * (num_nodes + 1), MEM_CODE);
+    memset(node_samples, 0, sizeof(uint64_t) * (num_nodes + 1));
+    sample_output = output;
+    sample_script = script_name;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sample_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, NULL) != 0) return false;
+
+    if (hz <= 0) hz = SAMPLE_DEFAULT_HZ;
+    if (hz > 1000000) hz = 1000000;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / hz;
+    timer.it_value = timer.it_interval;
+
+    atexit(sample_finish);
+    return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+}
+
+#else
+
+bool sample_start(int32_t hz, char *output, char *script_name) {
+    fputs("[sample] not supported on this platform\n", stderr);
+    return false;
+}
+
+#endif
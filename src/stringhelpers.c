@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include <stringhelpers.h>
 
@@ -39,33 +40,6 @@ int32_t get_char_occurances(char *str, char *c) {
     return counter;
 }
 
-/**
- * Returns the all chars in a string up until `delim` into `buf`
- */
-int32_t split_string_delimiter(char *buf, char *str, char *delim) {
-    int32_t delim_pos = str_index_of(str, delim);
-    if (delim_pos <= -1) return -1;
-    strncpy(buf, str, delim_pos);
-    return 0;
-}
-
-/**
- * Returns all chars in a string from the end up until `delim` into `buf`
- */
-int32_t split_string_delimiter_rev(char *buf, char *str, char *delim) {
-    int32_t last_delim_pos = -1;
-    int32_t i;
-    for (i=0; i<strlen(str); i++) {
-        if (strncmp(str+i, delim, strlen(delim)) == 0) last_delim_pos = i;
-    }
-    if (last_delim_pos <= -1) return -1;
-
-    for (i=0; i<strlen(str) - last_delim_pos - 1; i++) {
-        buf[i] = str[strlen(str)-i-1];
-    }
-    return 0;
-}
-
 /**
  * Index of the first occurance of `c` in `str`
  */
@@ -118,3 +92,54 @@ int32_t find_option(int argc, char **argv, char *request, int32_t *counter) {
     }
     return -1;
 }
+
+/**
+ * Search the program arguments for a long option of the form --name or
+ * --name=value
+ * @return the value, an empty string if no value was given, or NULL if the
+ *         option isn't present
+ */
+char * find_long_option(int argc, char **argv, char *name) {
+    int32_t name_len = strlen(name);
+    int32_t i;
+    for (i=1; i<argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) continue;
+        if (strncmp(argv[i]+2, name, name_len) != 0) continue;
+
+        char *rest = argv[i] + 2 + name_len;
+        if (*rest == '=') return rest + 1;
+        if (*rest == '\0') return rest;
+    }
+    return NULL;
+}
+
+/**
+ * FNV-1a hash of `len` bytes of a string, used by the hash tables for
+ * variables and maps
+ */
+uint32_t str_hash(char *str, size_t len) {
+    uint32_t hash = 2166136261u;
+    size_t i;
+    for (i=0; i<len; i++) {
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Parse a number with an optional K, M or G suffix (powers of 1024)
+ * @return the number, or 0 if it isn't valid
+ */
+uint64_t parse_size(char *str) {
+    char *end;
+    unsigned long long val = strtoull(str, &end, 10);
+    if (end == str) return 0;
+
+    switch (*end) {
+        case 'k': case 'K': val <<= 10; end++; break;
+        case 'm': case 'M': val <<= 20; end++; break;
+        case 'g': case 'G': val <<= 30; end++; break;
+    }
+    return *end == '\0' ? val : 0;
+}
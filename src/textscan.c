@@ -0,0 +1,211 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the text kernels behind the string commands, split() and
+ * csv(). Where SSE2 is available they work on 16 bytes at a time, otherwise
+ * case conversion and text_index() work on 8 bytes at a time in a 64-bit word
+ * and the rest falls back to scalar loops or the C library. Only ASCII letters
+ * change case and only ASCII whitespace is blank, so UTF-8 text passes through
+ * unchanged.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <textscan.h>
+
+static bool is_blank(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+#ifdef __SSE2__
+// Bytes between lo and hi, inclusive, as 0xff in a mask. Bytes above 0x7f
+// compare as negative, so they are never in an ASCII range.
+static __m128i in_range(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(x, _mm_set1_epi8(hi + 1)));
+}
+
+// One bit for every blank byte of 16 bytes at `str`
+static uint32_t blank_mask(char *str) {
+    __m128i x = _mm_loadu_si128((__m128i *) str);
+    __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                                 in_range(x, '\t', '\r'));
+    return _mm_movemask_epi8(blank);
+}
+#endif
+
+// Flip bit 5 of every byte between lo and hi, which changes their case
+static void flip_case(char *dst, char *src, size_t len, char lo, char hi) {
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i bit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((__m128i *) (src + i));
+        __m128i flip = _mm_and_si128(in_range(x, lo, hi), bit);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(x, flip));
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t high = 0x8080808080808080ULL;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, src + i, 8);
+        // Adding to the low 7 bits of every byte sets its high bit if the
+        // byte is at least the bound, without carrying into the next one
+        uint64_t low = w & ~high;
+        uint64_t ge_lo = low + ones * (0x80 - lo);
+        uint64_t gt_hi = low + ones * (0x80 - hi - 1);
+        uint64_t mask = ge_lo & ~gt_hi & ~w & high;
+        w ^= mask >> 2;
+        memcpy(dst + i, &w, 8);
+    }
+#endif
+    for (; i < len; i++) {
+        char c = src[i];
+        dst[i] = c >= lo && c <= hi ? c ^ 0x20 : c;
+    }
+}
+
+/**
+ * Convert `len` characters of `src` to upper case into `dst`, which may be
+ * the same buffer
+ */
+void text_upper(char *dst, char *src, size_t len) {
+    flip_case(dst, src, len, 'a', 'z');
+}
+
+/**
+ * Convert `len` characters of `src` to lower case into `dst`, which may be
+ * the same buffer
+ */
+void text_lower(char *dst, char *src, size_t len) {
+    flip_case(dst, src, len, 'A', 'Z');
+}
+
+/**
+ * Number of blank characters at the start of `str`
+ */
+size_t text_blank_prefix(char *str, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        uint32_t mask = blank_mask(str + i);
+        if (mask != 0xffff) return i + __builtin_ctz(~mask);
+    }
+#endif
+    while (i < len && is_blank(str[i])) i++;
+    return i;
+}
+
+/**
+ * Number of blank characters at the end of `str`
+ */
+size_t text_blank_suffix(char *str, size_t len) {
+    size_t n = 0;
+#ifdef __SSE2__
+    for (; n + 16 <= len; n += 16) {
+        uint32_t mask = blank_mask(str + len - n - 16);
+        if (mask != 0xffff) {
+            int32_t last = 31 - __builtin_clz(~mask & 0xffff);
+            return n + 15 - last;
+        }
+    }
+#endif
+    while (n < len && is_blank(str[len - n - 1])) n++;
+    return n;
+}
+
+/**
+ * Find the first occurrence of `needle` in `len` characters of `haystack`.
+ * Candidates are positions where both the first and the last character of
+ * the needle match, which rules out almost all others 16 at a time.
+ * @return the occurrence, or NULL if there is none
+ */
+char * text_find(char *haystack, size_t len, char *needle, size_t needle_len) {
+    if (needle_len == 0) return haystack;
+    if (needle_len > len) return NULL;
+
+    size_t i = 0;
+    size_t last = len - needle_len; // Last possible start
+#ifdef __SSE2__
+    __m128i first_char = _mm_set1_epi8(needle[0]);
+    __m128i last_char = _mm_set1_epi8(needle[needle_len - 1]);
+    for (; i + 16 <= last + 1; i += 16) {
+        __m128i a = _mm_loadu_si128((__m128i *) (haystack + i));
+        __m128i b = _mm_loadu_si128((__m128i *) (haystack + i +
+                                                 needle_len - 1));
+        uint32_t mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first_char),
+                          _mm_cmpeq_epi8(b, last_char)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (memcmp(haystack + pos, needle, needle_len) == 0)
+                return haystack + pos;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // memchr() is vectorized by the C library
+    while (i <= last) {
+        char *cand = memchr(haystack + i, needle[0], last - i + 1);
+        if (cand == NULL) return NULL;
+        if (memcmp(cand, needle, needle_len) == 0) return cand;
+        i = cand - haystack + 1;
+    }
+    return NULL;
+}
+
+/**
+ * Find every occurrence of `a` or `b` in `len` characters of `str`. Each
+ * block of the text is turned into a bitmask of matching bytes, and only
+ * the set bits are visited, so text without them is skipped at full speed.
+ * @param pos receives the offsets in order, and needs room for `len`
+ * @return the number of offsets
+ */
+size_t text_index(char *str, size_t len, char a, char b, uint32_t *pos) {
+    size_t n = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i a_char = _mm_set1_epi8(a);
+    __m128i b_char = _mm_set1_epi8(b);
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((__m128i *) (str + i));
+        uint32_t mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(x, a_char), _mm_cmpeq_epi8(x, b_char)));
+        while (mask != 0) {
+            pos[n++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t low = 0x7f7f7f7f7f7f7f7fULL;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, str + i, 8);
+        // Matching bytes become zero, and zero bytes get their high bit set
+        uint64_t x = w ^ (ones * (uint8_t) a);
+        uint64_t y = w ^ (ones * (uint8_t) b);
+        uint64_t mask = ~(((x & low) + low) | x | low) |
+                        ~(((y & low) + low) | y | low);
+        while (mask != 0) {
+            pos[n++] = i + __builtin_ctzll(mask) / 8;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (str[i] == a || str[i] == b) pos[n++] = i;
+    }
+    return n;
+}
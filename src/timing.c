@@ -0,0 +1,219 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the timer behind -t. The wall-clock time of loading,
+ * parsing and executing the script is measured with CLOCK_MONOTONIC, and
+ * every command handler that runs is timed by the execution loops, which
+ * call timing_record() when timing_enabled is set.
+ *
+ * Latencies go into a log-linear histogram per command, in the style of
+ * HdrHistogram: values below 16ns have a bucket each, and every power of two
+ * above that is split into 16 buckets. The report is printed at exit, as a
+ * table or with --time-json as JSON.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <timing.h>
+#include <memstat.h>
+
+// Max number of distinct commands, a power of two
+#define TIMING_MAX_COMMANDS 256
+
+bool timing_enabled;
+
+struct cmd_timing {
+    char *name; // Name of the registered command, compared by pointer
+    uint64_t calls;
+    uint64_t total;
+    uint64_t max;
+    uint64_t buckets[TIMING_NUM_BUCKETS];
+};
+typedef struct cmd_timing cmd_timing_t;
+
+static cmd_timing_t *commands[TIMING_MAX_COMMANDS];
+static int32_t num_commands;
+static pthread_mutex_t commands_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char *phase_names[PHASE_NUM_PHASES] = {
+    "load",
+    "parse",
+    "execute",
+};
+
+static uint64_t phase_times[PHASE_NUM_PHASES];
+static int32_t current_phase = -1;
+static uint64_t phase_start;
+static bool report_json;
+
+/**
+ * Nanoseconds from an arbitrary point, which never goes backward
+ */
+uint64_t timing_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int32_t bucket_of(uint64_t ns) {
+    if (ns < TIMING_SUB_BUCKETS) return ns;
+
+    int32_t exp = 63 - __builtin_clzll(ns); // At least 4
+    int32_t sub = (ns >> (exp - 4)) & (TIMING_SUB_BUCKETS - 1);
+    return (exp - 3) * TIMING_SUB_BUCKETS + sub;
+}
+
+// Highest value that falls into a bucket
+static uint64_t bucket_max(int32_t bucket) {
+    if (bucket < TIMING_SUB_BUCKETS) return bucket;
+
+    int32_t exp = bucket / TIMING_SUB_BUCKETS + 3;
+    uint64_t sub = bucket % TIMING_SUB_BUCKETS;
+    uint64_t width = 1ULL << (exp - 4);
+    return (TIMING_SUB_BUCKETS + sub) * width + width - 1;
+}
+
+/**
+ * Value below which `percent` of the calls of a command fall
+ */
+static uint64_t percentile(cmd_timing_t *cmd, double percent) {
+    uint64_t rank = (uint64_t) (cmd->calls * percent / 100.0 + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    int32_t i;
+    for (i=0; i<TIMING_NUM_BUCKETS; i++) {
+        seen += cmd->buckets[i];
+        if (seen >= rank) {
+            uint64_t value = bucket_max(i);
+            return value < cmd->max ? value : cmd->max;
+        }
+    }
+    return cmd->max;
+}
+
+static cmd_timing_t * find_command(char *name) {
+    uint32_t mask = TIMING_MAX_COMMANDS - 1;
+    uint32_t i = ((uintptr_t) name >> 3) & mask;
+    while (commands[i] != NULL && commands[i]->name != name) {
+        i = (i + 1) & mask;
+    }
+    if (commands[i] != NULL) return commands[i];
+
+    // Keep a free slot so that probing always ends
+    if (num_commands == TIMING_MAX_COMMANDS - 1) return NULL;
+    cmd_timing_t *cmd = basilc_malloc(sizeof(cmd_timing_t), MEM_CMDS);
+    memset(cmd, 0, sizeof(cmd_timing_t));
+    cmd->name = name;
+    commands[i] = cmd;
+    num_commands++;
+    return cmd;
+}
+
+/**
+ * Account one call of a command that took `ns` nanoseconds
+ */
+void timing_record(char *command, uint64_t ns) {
+    pthread_mutex_lock(&commands_lock);
+    cmd_timing_t *cmd = find_command(command);
+    if (cmd != NULL) {
+        cmd->calls++;
+        cmd->total += ns;
+        if (ns > cmd->max) cmd->max = ns;
+        cmd->buckets[bucket_of(ns)]++;
+    }
+    pthread_mutex_unlock(&commands_lock);
+}
+
+/**
+ * End the current phase and start `phase`
+ */
+void timing_phase(int32_t phase) {
+    uint64_t now = timing_now();
+    if (current_phase >= 0) phase_times[current_phase] += now - phase_start;
+    current_phase = phase;
+    phase_start = now;
+}
+
+// Sort commands by total time, slowest first
+static int compare_total(const void *a, const void *b) {
+    cmd_timing_t *x = *(cmd_timing_t **) a;
+    cmd_timing_t *y = *(cmd_timing_t **) b;
+    if (x->total != y->total) return x->total < y->total ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+static void timing_report() {
+    // The program may have ended through end()
+    timing_phase(-1);
+
+    cmd_timing_t *sorted[TIMING_MAX_COMMANDS];
+    int32_t i, n = 0;
+    uint64_t total = 0;
+    for (i=0; i<TIMING_MAX_COMMANDS; i++) {
+        if (commands[i] != NULL) sorted[n++] = commands[i];
+    }
+    qsort(sorted, n, sizeof(cmd_timing_t *), compare_total);
+    for (i=0; i<PHASE_NUM_PHASES; i++) total += phase_times[i];
+
+    fflush(stdout);
+    if (report_json) {
+        printf("{\"phases\": {");
+        for (i=0; i<PHASE_NUM_PHASES; i++) {
+            printf("\"%s\": %llu, ", phase_names[i],
+                   (unsigned long long) phase_times[i]);
+        }
+        printf("\"total\": %llu}, \"commands\": [", (unsigned long long) total);
+        for (i=0; i<n; i++) {
+            cmd_timing_t *cmd = sorted[i];
+            printf("%s{\"name\": \"%s\", \"calls\": %llu, \"total\": %llu, "
+                   "\"p50\": %llu, \"p99\": %llu, \"max\": %llu}",
+                   i ? ", " : "", cmd->name,
+                   (unsigned long long) cmd->calls,
+                   (unsigned long long) cmd->total,
+                   (unsigned long long) percentile(cmd, 50),
+                   (unsigned long long) percentile(cmd, 99),
+                   (unsigned long long) cmd->max);
+        }
+        printf("], \"unit\": \"ns\"}\n");
+        return;
+    }
+
+    printf("\nWall-clock time (seconds)\n");
+    for (i=0; i<PHASE_NUM_PHASES; i++) {
+        printf("%-10s %12.6f\n", phase_names[i], phase_times[i] / 1e9);
+    }
+    printf("%-10s %12.6f\n", "total", total / 1e9);
+
+    if (n == 0) return;
+    printf("\n%-12s %10s %12s %10s %10s %10s\n", "Command", "Calls",
+           "Total ms", "p50 us", "p99 us", "Max us");
+    for (i=0; i<n; i++) {
+        cmd_timing_t *cmd = sorted[i];
+        printf("%-12s %10llu %12.3f %10.3f %10.3f %10.3f\n", cmd->name,
+               (unsigned long long) cmd->calls, cmd->total / 1e6,
+               percentile(cmd, 50) / 1e3, percentile(cmd, 99) / 1e3,
+               cmd->max / 1e3);
+    }
+}
+
+/**
+ * Enable timing. The report is printed to stdout at exit, as JSON if `json`
+ * is set.
+ */
+void timing_init(bool json) {
+    timing_enabled = true;
+    report_json = json;
+    atexit(timing_report);
+}
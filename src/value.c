@@ -0,0 +1,183 @@
+/**
+ * The BasilC Interpreter
+ * Copyright (C) Shawn Anastasio 2016
+ * Licensed under the GNU GPL v3
+ */
+/**
+ * This file contains the representation of variable contents. Short values
+ * live in a single buffer that grows geometrically at both ends. Once a value
+ * outgrows VALUE_CHUNK_MAX, further appends and prepends add chunks to a
+ * rope instead of copying everything into a bigger buffer. Ropes are only
+ * flattened when a caller needs a plain C string.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <value.h>
+#include <memstat.h>
+
+static value_chunk_t * chunk_create(size_t cap, size_t start) {
+    value_chunk_t *chunk = basilc_malloc(sizeof(value_chunk_t), MEM_VARS);
+    chunk->buf = basilc_malloc(cap, MEM_VARS);
+    chunk->cap = cap;
+    chunk->start = start;
+    chunk->len = 0;
+    chunk->buf[start] = '\0';
+    chunk->next = NULL;
+    return chunk;
+}
+
+static void chunk_free(value_chunk_t *chunk) {
+    basilc_free(chunk->buf);
+    basilc_free(chunk);
+}
+
+void value_init(value_t *v) {
+    v->head = NULL;
+    v->tail = NULL;
+    v->len = 0;
+}
+
+/**
+ * Replace the contents of a value, reusing its first buffer when possible
+ */
+void value_set(value_t *v, char *str, size_t len) {
+    if (v->head == NULL) {
+        v->head = v->tail = chunk_create(len < 16 ? 16 : len + 1, 0);
+    }
+
+    // Drop everything but the first chunk
+    value_chunk_t *cur = v->head->next;
+    while (cur != NULL) {
+        value_chunk_t *next = cur->next;
+        chunk_free(cur);
+        cur = next;
+    }
+    v->head->next = NULL;
+    v->tail = v->head;
+
+    value_chunk_t *chunk = v->head;
+    if (len + 1 > chunk->cap) {
+        chunk->cap = len + 1;
+        chunk->buf = basilc_realloc(chunk->buf, chunk->cap, MEM_VARS);
+    }
+    memcpy(chunk->buf, str, len);
+    chunk->buf[len] = '\0';
+    chunk->start = 0;
+    chunk->len = len;
+    v->len = len;
+}
+
+void value_append(value_t *v, char *str, size_t len) {
+    if (v->head == NULL) {
+        value_set(v, str, len);
+        return;
+    }
+
+    value_chunk_t *tail = v->tail;
+    size_t needed = tail->start + tail->len + len + 1;
+    if (needed > tail->cap) {
+        if (tail->len + len < VALUE_CHUNK_MAX || tail->len == 0) {
+            // Grow geometrically
+            size_t cap = tail->cap * 2;
+            if (cap < needed) cap = needed;
+            tail->buf = basilc_realloc(tail->buf, cap, MEM_VARS);
+            tail->cap = cap;
+        } else {
+            // Start a new rope chunk
+            size_t cap = len + 1 > VALUE_CHUNK_MAX ? len + 1 : VALUE_CHUNK_MAX;
+            tail->next = chunk_create(cap, 0);
+            tail = v->tail = tail->next;
+        }
+    }
+
+    memcpy(tail->buf + tail->start + tail->len, str, len);
+    tail->len += len;
+    tail->buf[tail->start + tail->len] = '\0';
+    v->len += len;
+}
+
+void value_prepend(value_t *v, char *str, size_t len) {
+    if (v->head == NULL) {
+        value_set(v, str, len);
+        return;
+    }
+
+    value_chunk_t *head = v->head;
+    if (head->start < len) {
+        if (head->len + len < VALUE_CHUNK_MAX || head->len == 0) {
+            // Regrow with a gap in front as large as the text itself
+            size_t gap = head->len > len ? head->len : len;
+            size_t cap = gap + head->len + (head->cap - head->start - head->len);
+            char *buf = basilc_malloc(cap, MEM_VARS);
+            memcpy(buf + gap, head->buf + head->start, head->len + 1);
+            basilc_free(head->buf);
+            head->buf = buf;
+            head->cap = cap;
+            head->start = gap;
+        } else {
+            // Start a new rope chunk, filled from the back
+            size_t cap = len + 1 > VALUE_CHUNK_MAX ? len + 1 : VALUE_CHUNK_MAX;
+            value_chunk_t *chunk = chunk_create(cap, cap - 1);
+            chunk->next = head;
+            head = v->head = chunk;
+        }
+    }
+
+    head->start -= len;
+    memcpy(head->buf + head->start, str, len);
+    head->len += len;
+    v->len += len;
+}
+
+/**
+ * Get a value as a C string, joining its chunks if it is a rope
+ */
+char * value_flatten(value_t *v) {
+    if (v->head == NULL) return "";
+    if (v->head == v->tail) return v->head->buf + v->head->start;
+
+    value_chunk_t *chunk = chunk_create(v->len + 1, 0);
+    value_copy(v, chunk->buf);
+    chunk->buf[v->len] = '\0';
+    chunk->len = v->len;
+
+    value_free(v);
+    v->head = v->tail = chunk;
+    v->len = chunk->len;
+    return chunk->buf;
+}
+
+/**
+ * Copy the text of a value to `dst`, without a terminator
+ * @return number of bytes copied
+ */
+size_t value_copy(value_t *v, char *dst) {
+    value_chunk_t *cur;
+    size_t pos = 0;
+    for (cur = v->head; cur != NULL; cur = cur->next) {
+        memcpy(dst + pos, cur->buf + cur->start, cur->len);
+        pos += cur->len;
+    }
+    return pos;
+}
+
+void value_write(value_t *v, FILE *out) {
+    value_chunk_t *cur;
+    for (cur = v->head; cur != NULL; cur = cur->next) {
+        fwrite(cur->buf + cur->start, 1, cur->len, out);
+    }
+}
+
+void value_free(value_t *v) {
+    value_chunk_t *cur = v->head;
+    while (cur != NULL) {
+        value_chunk_t *next = cur->next;
+        chunk_free(cur);
+        cur = next;
+    }
+    value_init(v);
+}
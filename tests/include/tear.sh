@@ -0,0 +1,5 @@
+#!/bin/sh
+# Overwrites the first byte of the text $2 in the state file $1, like a crash
+# in the middle of writing that value would.
+off=$(grep -obUa "$2" "$1" | head -n 1 | cut -d: -f1)
+printf X | dd of="$1" bs=1 seek="$off" conv=notrunc 2>/dev/null
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Runs every tests/*.basilc script on each execution engine and compares its
+# standard output, followed by a line with its exit status, with
+# tests/<name>.expected. A line of the form "#// options: ..." in a script
+# adds options to every run of it.
+
+BASILC=${BASILC:-out/basilc}
+failed=0
+total=0
+
+for script in tests/*.basilc; do
+    name=${script%.basilc}
+    options=$(sed -n 's|^#// options: ||p' "$script")
+    for engine in "" "-f" "--jit"; do
+        total=$((total + 1))
+        # A hang is killed and shows up as exit status 124
+        timeout 10 $BASILC -m -d $engine $options "$script" \
+            > "$name.out" 2>/dev/null < /dev/null
+        echo "exit $?" >> "$name.out"
+        if cmp -s "$name.out" "$name.expected"; then
+            rm -f "$name.out"
+        else
+            echo "FAIL: $script ${engine:-(default engine)}"
+            diff "$name.expected" "$name.out" | head -20
+            failed=$((failed + 1))
+        fi
+    done
+done
+
+echo "$((total - failed))/$total passed"
+[ $failed -eq 0 ]